@@ -0,0 +1,434 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+
+// Axis-aligned bounding box
+struct AABB {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+};
+
+AABB mergeBounds(const AABB& a, const AABB& b) {
+    return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+}
+
+bool containsBounds(const AABB& outer, const AABB& inner) {
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+           outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+float surfaceArea(const AABB& bounds) {
+    glm::vec3 size = bounds.max - bounds.min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+// World bounds of a transformed local box (Arvo's method)
+AABB transformBounds(const glm::mat4& matrix, const glm::vec3& localMin, const glm::vec3& localMax) {
+    AABB result;
+    result.min = result.max = glm::vec3(matrix[3]);
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++) {
+            float a = matrix[column][row] * localMin[column];
+            float b = matrix[column][row] * localMax[column];
+            result.min[row] += std::min(a, b);
+            result.max[row] += std::max(a, b);
+        }
+    }
+    return result;
+}
+
+// Test a box against the planes still set in planeMask. Planes the box is fully
+// in front of are cleared from the mask, so children skip them.
+bool boundsInFrustum(const Frustum& frustum, const AABB& bounds, unsigned int& planeMask) {
+    for (int p = 0; p < 6; p++) {
+        if (!(planeMask & (1u << p))) continue;
+        const glm::vec4& plane = frustum.planes[p];
+
+        // Corner furthest along the plane normal
+        glm::vec3 positive(plane.x >= 0.0f ? bounds.max.x : bounds.min.x,
+                           plane.y >= 0.0f ? bounds.max.y : bounds.min.y,
+                           plane.z >= 0.0f ? bounds.max.z : bounds.min.z);
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) return false;
+
+        glm::vec3 negative(plane.x >= 0.0f ? bounds.min.x : bounds.max.x,
+                           plane.y >= 0.0f ? bounds.min.y : bounds.max.y,
+                           plane.z >= 0.0f ? bounds.min.z : bounds.max.z);
+        if (glm::dot(glm::vec3(plane), negative) + plane.w >= 0.0f) planeMask &= ~(1u << p);
+    }
+    return true;
+}
+
+// 1 / d for the slab test. Zero components would give 0 * inf = NaN on a slab
+// the origin sits in, and a NaN drops a box the ray does hit, so they get a
+// large finite value of the same sign instead.
+glm::vec3 rayInverseDirection(const glm::vec3& direction) {
+    glm::vec3 inverse;
+    for (int axis = 0; axis < 3; axis++) {
+        float d = direction[axis];
+        inverse[axis] = std::abs(d) > 1e-20f ? 1.0f / d : std::copysign(1e20f, d);
+    }
+    return inverse;
+}
+
+// Slab test, writes the entry distance when the ray hits the box before maxDistance
+bool rayIntersectsBounds(const glm::vec3& origin, const glm::vec3& inverseDirection, const AABB& bounds, float maxDistance, float& entryDistance) {
+    glm::vec3 t0 = (bounds.min - origin) * inverseDirection;
+    glm::vec3 t1 = (bounds.max - origin) * inverseDirection;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+    if (enter > exit) return false;
+    entryDistance = enter;
+    return true;
+}
+
+const int32_t BVH_NULL = -1;
+
+struct BvhNode {
+    AABB bounds;        // Fattened for leaves so small moves do not touch the tree
+    AABB tightBounds;   // Exact leaf bounds, used for the final leaf tests
+    int32_t parent = BVH_NULL; // Next free node while on the free list
+    int32_t left = BVH_NULL;
+    int32_t right = BVH_NULL;
+    int32_t height = 0; // 0 for leaves, -1 for free nodes
+    uint32_t userData = 0;
+
+    bool isLeaf() const { return left == BVH_NULL; }
+};
+
+// Dynamic AABB tree with surface-area guided insertion and AVL-style rotations
+struct DynamicBvh {
+    std::vector<BvhNode> nodes;
+    int32_t root = BVH_NULL;
+    int32_t freeList = BVH_NULL;
+    size_t leafCount = 0;
+    float margin = 0.1f;
+
+    // Traversal scratch, kept around to avoid allocating per query
+    std::vector<std::pair<int32_t, unsigned int>> cullStack;
+    std::vector<int32_t> stack;
+
+    void clear() {
+        nodes.clear();
+        root = BVH_NULL;
+        freeList = BVH_NULL;
+        leafCount = 0;
+    }
+
+    // Add a leaf and return its proxy id
+    int32_t insert(const AABB& bounds, uint32_t userData) {
+        int32_t leaf = allocateNode();
+        nodes[leaf].tightBounds = bounds;
+        nodes[leaf].bounds = { bounds.min - glm::vec3(margin), bounds.max + glm::vec3(margin) };
+        nodes[leaf].userData = userData;
+        nodes[leaf].height = 0;
+        insertLeaf(leaf);
+        leafCount++;
+        return leaf;
+    }
+
+    void remove(int32_t leaf) {
+        removeLeaf(leaf);
+        freeNode(leaf);
+        leafCount--;
+    }
+
+    // Refit a leaf to new bounds. The tree only changes when the object
+    // leaves its fattened box; returns true in that case.
+    bool move(int32_t leaf, const AABB& bounds) {
+        nodes[leaf].tightBounds = bounds;
+        if (containsBounds(nodes[leaf].bounds, bounds)) return false;
+
+        removeLeaf(leaf);
+        nodes[leaf].bounds = { bounds.min - glm::vec3(margin), bounds.max + glm::vec3(margin) };
+        insertLeaf(leaf);
+        return true;
+    }
+
+    // Append the user data of every leaf touching the frustum.
+    // Subtrees fully inside are collected without further plane tests.
+    void cullFrustum(const Frustum& frustum, std::vector<uint32_t>& visible) {
+        if (root == BVH_NULL) return;
+        cullStack.clear();
+        cullStack.push_back({ root, 0x3Fu });
+
+        while (!cullStack.empty()) {
+            auto [index, planeMask] = cullStack.back();
+            cullStack.pop_back();
+            const BvhNode& node = nodes[index];
+
+            if (node.isLeaf()) {
+                if (boundsInFrustum(frustum, node.tightBounds, planeMask)) visible.push_back(node.userData);
+                continue;
+            }
+            if (!boundsInFrustum(frustum, node.bounds, planeMask)) continue;
+
+            if (planeMask == 0) {
+                collectLeaves(index, visible);
+            } else {
+                cullStack.push_back({ node.left, planeMask });
+                cullStack.push_back({ node.right, planeMask });
+            }
+        }
+    }
+
+    // Find the closest leaf hit by a ray, returns false if nothing is hit within maxDistance
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, uint32_t& hitData, float& hitDistance) {
+        if (root == BVH_NULL) return false;
+        glm::vec3 inverseDirection = rayInverseDirection(direction);
+        bool found = false;
+        hitDistance = maxDistance;
+
+        stack.clear();
+        stack.push_back(root);
+        while (!stack.empty()) {
+            int32_t index = stack.back();
+            stack.pop_back();
+            const BvhNode& node = nodes[index];
+
+            float distance;
+            if (node.isLeaf()) {
+                if (rayIntersectsBounds(origin, inverseDirection, node.tightBounds, hitDistance, distance)) {
+                    hitDistance = distance;
+                    hitData = node.userData;
+                    found = true;
+                }
+                continue;
+            }
+            if (!rayIntersectsBounds(origin, inverseDirection, node.bounds, hitDistance, distance)) continue;
+
+            // Visit the nearer child first so it can shrink the search distance
+            float leftDistance = 0.0f, rightDistance = 0.0f;
+            bool hitLeft = rayIntersectsBounds(origin, inverseDirection, nodes[node.left].bounds, hitDistance, leftDistance);
+            bool hitRight = rayIntersectsBounds(origin, inverseDirection, nodes[node.right].bounds, hitDistance, rightDistance);
+            if (hitLeft && hitRight) {
+                bool leftFirst = leftDistance <= rightDistance;
+                stack.push_back(leftFirst ? node.right : node.left);
+                stack.push_back(leftFirst ? node.left : node.right);
+            } else if (hitLeft) {
+                stack.push_back(node.left);
+            } else if (hitRight) {
+                stack.push_back(node.right);
+            }
+        }
+        return found;
+    }
+
+private:
+    int32_t allocateNode() {
+        if (freeList == BVH_NULL) {
+            nodes.emplace_back();
+            return static_cast<int32_t>(nodes.size()) - 1;
+        }
+        int32_t index = freeList;
+        freeList = nodes[index].parent;
+        nodes[index] = BvhNode();
+        return index;
+    }
+
+    void freeNode(int32_t index) {
+        nodes[index].parent = freeList;
+        nodes[index].height = -1;
+        freeList = index;
+    }
+
+    void collectLeaves(int32_t start, std::vector<uint32_t>& out) {
+        size_t base = stack.size();
+        stack.push_back(start);
+        while (stack.size() > base) {
+            int32_t index = stack.back();
+            stack.pop_back();
+            const BvhNode& node = nodes[index];
+            if (node.isLeaf()) {
+                out.push_back(node.userData);
+            } else {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+    }
+
+    void insertLeaf(int32_t leaf) {
+        if (root == BVH_NULL) {
+            root = leaf;
+            nodes[root].parent = BVH_NULL;
+            return;
+        }
+
+        // Walk down to the sibling that adds the least surface area
+        AABB leafBounds = nodes[leaf].bounds;
+        int32_t index = root;
+        while (!nodes[index].isLeaf()) {
+            const BvhNode& node = nodes[index];
+            float area = surfaceArea(node.bounds);
+            float combinedArea = surfaceArea(mergeBounds(node.bounds, leafBounds));
+
+            // Cost of a new parent for this node and the leaf
+            float cost = 2.0f * combinedArea;
+            // Minimum cost of pushing the leaf further down
+            float inheritanceCost = 2.0f * (combinedArea - area);
+
+            auto descendCost = [&](int32_t child) {
+                const BvhNode& childNode = nodes[child];
+                float merged = surfaceArea(mergeBounds(leafBounds, childNode.bounds));
+                if (childNode.isLeaf()) return merged + inheritanceCost;
+                return merged - surfaceArea(childNode.bounds) + inheritanceCost;
+            };
+            float costLeft = descendCost(node.left);
+            float costRight = descendCost(node.right);
+
+            if (cost < costLeft && cost < costRight) break;
+            index = costLeft < costRight ? node.left : node.right;
+        }
+        int32_t sibling = index;
+
+        // Create a parent for the sibling and the leaf
+        int32_t oldParent = nodes[sibling].parent;
+        int32_t newParent = allocateNode();
+        nodes[newParent].parent = oldParent;
+        nodes[newParent].bounds = mergeBounds(leafBounds, nodes[sibling].bounds);
+        nodes[newParent].height = nodes[sibling].height + 1;
+        nodes[newParent].left = sibling;
+        nodes[newParent].right = leaf;
+        nodes[sibling].parent = newParent;
+        nodes[leaf].parent = newParent;
+
+        if (oldParent != BVH_NULL) {
+            if (nodes[oldParent].left == sibling) nodes[oldParent].left = newParent;
+            else nodes[oldParent].right = newParent;
+        } else {
+            root = newParent;
+        }
+
+        refitAncestors(nodes[leaf].parent);
+    }
+
+    void removeLeaf(int32_t leaf) {
+        if (leaf == root) {
+            root = BVH_NULL;
+            return;
+        }
+
+        int32_t parent = nodes[leaf].parent;
+        int32_t grandParent = nodes[parent].parent;
+        int32_t sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+        if (grandParent != BVH_NULL) {
+            // Replace the parent with the sibling
+            if (nodes[grandParent].left == parent) nodes[grandParent].left = sibling;
+            else nodes[grandParent].right = sibling;
+            nodes[sibling].parent = grandParent;
+            freeNode(parent);
+            refitAncestors(grandParent);
+        } else {
+            root = sibling;
+            nodes[sibling].parent = BVH_NULL;
+            freeNode(parent);
+        }
+    }
+
+    // Walk to the root, rebalancing and refitting each node on the way
+    void refitAncestors(int32_t index) {
+        while (index != BVH_NULL) {
+            index = balance(index);
+            BvhNode& node = nodes[index];
+            node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+            node.bounds = mergeBounds(nodes[node.left].bounds, nodes[node.right].bounds);
+            index = node.parent;
+        }
+    }
+
+    // Rotate the taller grandchild up when the subtree is out of balance, returns the new subtree root
+    int32_t balance(int32_t iA) {
+        BvhNode& A = nodes[iA];
+        if (A.isLeaf() || A.height < 2) return iA;
+
+        int32_t iB = A.left;
+        int32_t iC = A.right;
+        BvhNode& B = nodes[iB];
+        BvhNode& C = nodes[iC];
+        int32_t heightDifference = C.height - B.height;
+
+        // Rotate C up
+        if (heightDifference > 1) {
+            int32_t iF = C.left;
+            int32_t iG = C.right;
+            BvhNode& F = nodes[iF];
+            BvhNode& G = nodes[iG];
+
+            C.left = iA;
+            C.parent = A.parent;
+            A.parent = iC;
+            replaceChild(C.parent, iA, iC);
+
+            if (F.height > G.height) {
+                C.right = iF;
+                A.right = iG;
+                G.parent = iA;
+                A.bounds = mergeBounds(B.bounds, G.bounds);
+                C.bounds = mergeBounds(A.bounds, F.bounds);
+                A.height = 1 + std::max(B.height, G.height);
+                C.height = 1 + std::max(A.height, F.height);
+            } else {
+                C.right = iG;
+                A.right = iF;
+                F.parent = iA;
+                A.bounds = mergeBounds(B.bounds, F.bounds);
+                C.bounds = mergeBounds(A.bounds, G.bounds);
+                A.height = 1 + std::max(B.height, F.height);
+                C.height = 1 + std::max(A.height, G.height);
+            }
+            return iC;
+        }
+
+        // Rotate B up
+        if (heightDifference < -1) {
+            int32_t iD = B.left;
+            int32_t iE = B.right;
+            BvhNode& D = nodes[iD];
+            BvhNode& E = nodes[iE];
+
+            B.left = iA;
+            B.parent = A.parent;
+            A.parent = iB;
+            replaceChild(B.parent, iA, iB);
+
+            if (D.height > E.height) {
+                B.right = iD;
+                A.left = iE;
+                E.parent = iA;
+                A.bounds = mergeBounds(C.bounds, E.bounds);
+                B.bounds = mergeBounds(A.bounds, D.bounds);
+                A.height = 1 + std::max(C.height, E.height);
+                B.height = 1 + std::max(A.height, D.height);
+            } else {
+                B.right = iE;
+                A.left = iD;
+                D.parent = iA;
+                A.bounds = mergeBounds(C.bounds, D.bounds);
+                B.bounds = mergeBounds(A.bounds, E.bounds);
+                A.height = 1 + std::max(C.height, D.height);
+                B.height = 1 + std::max(A.height, E.height);
+            }
+            return iB;
+        }
+
+        return iA;
+    }
+
+    void replaceChild(int32_t parent, int32_t oldChild, int32_t newChild) {
+        if (parent == BVH_NULL) {
+            root = newChild;
+        } else if (nodes[parent].left == oldChild) {
+            nodes[parent].left = newChild;
+        } else {
+            nodes[parent].right = newChild;
+        }
+    }
+};
@@ -21,6 +21,14 @@ public:
         return Projection;
     }
 
+    glm::vec3 getPosition() const {
+        return Position;
+    }
+
+    glm::vec3 getFront() const {
+        return Front;
+    }
+
     void processKeyboard(float deltaTime) {
         const float cameraSpeed = 2.5f * deltaTime;
         glm::vec3 resetC = Front;
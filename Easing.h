@@ -0,0 +1,214 @@
+#pragma once
+#include "Log.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define EASING_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+// AVX2 is compiled in with a target attribute and only used if the CPU has it
+#if defined(EASING_USE_SSE) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define EASING_USE_AVX2 1
+#include <immintrin.h>
+#endif
+
+// Easing curves applied to a tween's normalized time. The Penner set plus
+// cubic-bezier curves registered at runtime, which take ids from
+// EASE_CUBIC_BEZIER_FIRST up.
+enum EaseType : uint8_t {
+    EASE_LINEAR,
+    EASE_QUAD_IN,
+    EASE_QUAD_OUT,
+    EASE_QUAD_IN_OUT,
+    EASE_CUBIC_IN,
+    EASE_CUBIC_OUT,
+    EASE_CUBIC_IN_OUT,
+    EASE_QUART_IN,
+    EASE_QUART_OUT,
+    EASE_QUART_IN_OUT,
+    EASE_EXPO_IN,
+    EASE_EXPO_OUT,
+    EASE_EXPO_IN_OUT,
+    EASE_BACK_IN,
+    EASE_BACK_OUT,
+    EASE_BACK_IN_OUT,
+    EASE_ELASTIC_IN,
+    EASE_ELASTIC_OUT,
+    EASE_ELASTIC_IN_OUT,
+    EASE_BOUNCE_IN,
+    EASE_BOUNCE_OUT,
+    EASE_BOUNCE_IN_OUT,
+    EASE_CUBIC_BEZIER_FIRST = 64,
+
+    // The original names, quadratic
+    EASE_IN = EASE_QUAD_IN,
+    EASE_OUT = EASE_QUAD_OUT,
+    EASE_IN_OUT = EASE_QUAD_IN_OUT
+};
+
+// Polynomial form of a CSS cubic-bezier(x1, y1, x2, y2), ends fixed at 0 and 1
+struct CubicBezier {
+    float ax, bx, cx;
+    float ay, by, cy;
+};
+
+std::vector<CubicBezier> cubicBezierCurves;
+
+// Returns the easing id for the curve, EASE_LINEAR if every id is taken.
+// x1 and x2 are clamped to [0, 1] so x stays monotonic and has one solution.
+EaseType registerCubicBezier(float x1, float y1, float x2, float y2) {
+    if (cubicBezierCurves.size() > 255 - EASE_CUBIC_BEZIER_FIRST) {
+        LOG_ERROR << "ERROR::EASING Too many cubic-bezier curves, using linear";
+        return EASE_LINEAR;
+    }
+    x1 = std::clamp(x1, 0.0f, 1.0f);
+    x2 = std::clamp(x2, 0.0f, 1.0f);
+    CubicBezier curve;
+    curve.cx = 3.0f * x1;
+    curve.bx = 3.0f * (x2 - x1) - curve.cx;
+    curve.ax = 1.0f - curve.cx - curve.bx;
+    curve.cy = 3.0f * y1;
+    curve.by = 3.0f * (y2 - y1) - curve.cy;
+    curve.ay = 1.0f - curve.cy - curve.by;
+    cubicBezierCurves.push_back(curve);
+    return static_cast<EaseType>(EASE_CUBIC_BEZIER_FIRST + cubicBezierCurves.size() - 1);
+}
+
+// The curves in EasingCurves.inl are compiled once per vector type below.
+// Each namespace supplies the same handful of primitives.
+
+// One float at a time, the fallback and the tail of every batch
+namespace easing_scalar {
+    struct V { float v; };
+    const size_t WIDTH = 1;
+
+    inline V splat(float x) { return { x }; }
+    inline V load(const float* source) { return { *source }; }
+    inline void store(float* destination, V x) { *destination = x.v; }
+    inline V operator+(V a, V b) { return { a.v + b.v }; }
+    inline V operator-(V a, V b) { return { a.v - b.v }; }
+    inline V operator*(V a, V b) { return { a.v * b.v }; }
+    inline V operator/(V a, V b) { return { a.v / b.v }; }
+    inline V min(V a, V b) { return { std::min(a.v, b.v) }; }
+    inline V max(V a, V b) { return { std::max(a.v, b.v) }; }
+    inline V floor(V x) { return { std::floor(x.v) }; }
+    inline bool less(V a, V b) { return a.v < b.v; }
+    inline bool equal(V a, V b) { return a.v == b.v; }
+    inline V select(bool mask, V a, V b) { return mask ? a : b; }
+    inline V pow2i(V whole) { return { std::ldexp(1.0f, static_cast<int>(whole.v)) }; }
+
+#include "EasingCurves.inl"
+}
+
+#ifdef EASING_USE_SSE
+// Four floats per register, SSE2 only so every x86-64 CPU can run it
+namespace easing_sse {
+    struct V { __m128 v; };
+    const size_t WIDTH = 4;
+
+    inline V splat(float x) { return { _mm_set1_ps(x) }; }
+    inline V load(const float* source) { return { _mm_loadu_ps(source) }; }
+    inline void store(float* destination, V x) { _mm_storeu_ps(destination, x.v); }
+    inline V operator+(V a, V b) { return { _mm_add_ps(a.v, b.v) }; }
+    inline V operator-(V a, V b) { return { _mm_sub_ps(a.v, b.v) }; }
+    inline V operator*(V a, V b) { return { _mm_mul_ps(a.v, b.v) }; }
+    inline V operator/(V a, V b) { return { _mm_div_ps(a.v, b.v) }; }
+    inline V min(V a, V b) { return { _mm_min_ps(a.v, b.v) }; }
+    inline V max(V a, V b) { return { _mm_max_ps(a.v, b.v) }; }
+    inline V less(V a, V b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+    inline V equal(V a, V b) { return { _mm_cmpeq_ps(a.v, b.v) }; }
+    inline V select(V mask, V a, V b) { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+
+    // No round instruction before SSE4.1: truncate, then step down for negatives
+    inline V floor(V x) {
+        __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x.v));
+        __m128 tooHigh = _mm_cmpgt_ps(truncated, x.v);
+        return { _mm_sub_ps(truncated, _mm_and_ps(tooHigh, _mm_set1_ps(1.0f))) };
+    }
+
+    // Build the float exponent directly, whole is in [-126, 127]
+    inline V pow2i(V whole) {
+        __m128i exponent = _mm_add_epi32(_mm_cvtps_epi32(whole.v), _mm_set1_epi32(127));
+        return { _mm_castsi128_ps(_mm_slli_epi32(exponent, 23)) };
+    }
+
+#include "EasingCurves.inl"
+}
+#endif
+
+#ifdef EASING_USE_AVX2
+// Eight floats per register. Everything in here is compiled for AVX2 and FMA
+// whatever the build flags are, so it is only called after the CPU check.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+namespace easing_avx2 {
+    struct V { __m256 v; };
+    const size_t WIDTH = 8;
+
+    inline V splat(float x) { return { _mm256_set1_ps(x) }; }
+    inline V load(const float* source) { return { _mm256_loadu_ps(source) }; }
+    inline void store(float* destination, V x) { _mm256_storeu_ps(destination, x.v); }
+    inline V operator+(V a, V b) { return { _mm256_add_ps(a.v, b.v) }; }
+    inline V operator-(V a, V b) { return { _mm256_sub_ps(a.v, b.v) }; }
+    inline V operator*(V a, V b) { return { _mm256_mul_ps(a.v, b.v) }; }
+    inline V operator/(V a, V b) { return { _mm256_div_ps(a.v, b.v) }; }
+    inline V min(V a, V b) { return { _mm256_min_ps(a.v, b.v) }; }
+    inline V max(V a, V b) { return { _mm256_max_ps(a.v, b.v) }; }
+    inline V floor(V x) { return { _mm256_floor_ps(x.v) }; }
+    inline V less(V a, V b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+    inline V equal(V a, V b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ) }; }
+    inline V select(V mask, V a, V b) { return { _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+    inline V pow2i(V whole) {
+        __m256i exponent = _mm256_add_epi32(_mm256_cvtps_epi32(whole.v), _mm256_set1_epi32(127));
+        return { _mm256_castsi256_ps(_mm256_slli_epi32(exponent, 23)) };
+    }
+
+#include "EasingCurves.inl"
+}
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
+
+// Eases count normalized times of one curve into out
+using EaseBatchFunction = void (*)(uint8_t type, const float* t, float* out, size_t count);
+
+struct EasingKernel {
+    EaseBatchFunction function;
+    const char* name;
+};
+
+// Widest kernel this CPU runs, checked once at startup
+EasingKernel selectEasingKernel() {
+#ifdef EASING_USE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return { easing_avx2::easeBatch, "AVX2" };
+#endif
+#ifdef EASING_USE_SSE
+    return { easing_sse::easeBatch, "SSE2" };
+#else
+    return { easing_scalar::easeBatch, "scalar" };
+#endif
+}
+
+EasingKernel easingKernel = selectEasingKernel();
+
+void easeBatch(uint8_t type, const float* t, float* out, size_t count) {
+    easingKernel.function(type, t, out, count);
+}
+
+// One value, for callers outside the tween engine
+float applyEasing(uint8_t type, float t) {
+    return easing_scalar::easeVector(type, easing_scalar::splat(t)).v;
+}
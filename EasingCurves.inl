@@ -0,0 +1,200 @@
+// Easing curves written once against a small vector interface and compiled
+// once per instruction set. Easing.h includes this file inside a namespace
+// that defines V (the vector type), WIDTH and the primitives below, so there
+// is no include guard on purpose.
+//
+// Primitives: splat, load, store, min, max, floor, less, equal,
+// select(mask, ifTrue, ifFalse), pow2i (2^n for whole numbers n), and the
+// usual arithmetic operators.
+
+// 2^x, Cephes polynomial on [-0.5, 0.5] around the nearest whole power
+inline V exp2Approx(V x) {
+    x = max(min(x, splat(126.0f)), splat(-126.0f));
+    V whole = floor(x + splat(0.5f));
+    V f = x - whole;
+    V p = splat(1.535336188319500e-4f);
+    p = p * f + splat(1.339887440266574e-3f);
+    p = p * f + splat(9.618437357674640e-3f);
+    p = p * f + splat(5.550332471162809e-2f);
+    p = p * f + splat(2.402264791363012e-1f);
+    p = p * f + splat(6.931472028550421e-1f);
+    return (p * f + splat(1.0f)) * pow2i(whole);
+}
+
+// sin(x), reduced to [-pi/2, pi/2] then an odd Taylor polynomial
+inline V sinApprox(V x) {
+    const float pi = 3.14159265358979f;
+    V turns = floor(x * splat(0.5f / pi) + splat(0.5f));
+    x = x - turns * splat(2.0f * pi);
+    x = select(less(splat(pi * 0.5f), x), splat(pi) - x, x);
+    x = select(less(x, splat(-pi * 0.5f)), splat(-pi) - x, x);
+    V x2 = x * x;
+    V p = splat(-2.5052108e-8f);
+    p = p * x2 + splat(2.7557319e-6f);
+    p = p * x2 + splat(-1.9841270e-4f);
+    p = p * x2 + splat(8.3333333e-3f);
+    p = p * x2 + splat(-1.6666667e-1f);
+    return x + x * x2 * p;
+}
+
+inline V square(V x) { return x * x; }
+inline V cube(V x) { return x * x * x; }
+
+// Mirror an ease-in into ease-out and ease-in-out
+inline V outOf(V in) { return splat(1.0f) - in; }
+
+inline V easeQuadIn(V t) { return t * t; }
+inline V easeQuadOut(V t) { return outOf(square(splat(1.0f) - t)); }
+inline V easeQuadInOut(V t) {
+    return select(less(t, splat(0.5f)), splat(2.0f) * t * t, outOf(square(splat(-2.0f) * t + splat(2.0f)) * splat(0.5f)));
+}
+
+inline V easeCubicIn(V t) { return cube(t); }
+inline V easeCubicOut(V t) { return outOf(cube(splat(1.0f) - t)); }
+inline V easeCubicInOut(V t) {
+    return select(less(t, splat(0.5f)), splat(4.0f) * cube(t), outOf(cube(splat(-2.0f) * t + splat(2.0f)) * splat(0.5f)));
+}
+
+inline V easeQuartIn(V t) { return square(square(t)); }
+inline V easeQuartOut(V t) { return outOf(square(square(splat(1.0f) - t))); }
+inline V easeQuartInOut(V t) {
+    return select(less(t, splat(0.5f)), splat(8.0f) * square(square(t)), outOf(square(square(splat(-2.0f) * t + splat(2.0f))) * splat(0.5f)));
+}
+
+inline V easeExpoIn(V t) {
+    return select(equal(t, splat(0.0f)), splat(0.0f), exp2Approx(splat(10.0f) * t - splat(10.0f)));
+}
+inline V easeExpoOut(V t) {
+    return select(equal(t, splat(1.0f)), splat(1.0f), outOf(exp2Approx(splat(-10.0f) * t)));
+}
+inline V easeExpoInOut(V t) {
+    V in = exp2Approx(splat(20.0f) * t - splat(10.0f)) * splat(0.5f);
+    V out = (splat(2.0f) - exp2Approx(splat(-20.0f) * t + splat(10.0f))) * splat(0.5f);
+    V result = select(less(t, splat(0.5f)), in, out);
+    result = select(equal(t, splat(0.0f)), splat(0.0f), result);
+    return select(equal(t, splat(1.0f)), splat(1.0f), result);
+}
+
+// Overshoot of the back curves, the usual 10% value
+const float BACK_OVERSHOOT = 1.70158f;
+
+inline V easeBackIn(V t) {
+    return splat(BACK_OVERSHOOT + 1.0f) * cube(t) - splat(BACK_OVERSHOOT) * square(t);
+}
+inline V easeBackOut(V t) {
+    V u = t - splat(1.0f);
+    return splat(1.0f) + splat(BACK_OVERSHOOT + 1.0f) * cube(u) + splat(BACK_OVERSHOOT) * square(u);
+}
+inline V easeBackInOut(V t) {
+    const float c2 = BACK_OVERSHOOT * 1.525f;
+    V a = splat(2.0f) * t;
+    V b = a - splat(2.0f);
+    V in = square(a) * (splat(c2 + 1.0f) * a - splat(c2)) * splat(0.5f);
+    V out = (square(b) * (splat(c2 + 1.0f) * b + splat(c2)) + splat(2.0f)) * splat(0.5f);
+    return select(less(t, splat(0.5f)), in, out);
+}
+
+inline V easeElasticIn(V t) {
+    const float c4 = 2.0f * 3.14159265358979f / 3.0f;
+    V result = splat(0.0f) - exp2Approx(splat(10.0f) * t - splat(10.0f)) * sinApprox((splat(10.0f) * t - splat(10.75f)) * splat(c4));
+    result = select(equal(t, splat(0.0f)), splat(0.0f), result);
+    return select(equal(t, splat(1.0f)), splat(1.0f), result);
+}
+inline V easeElasticOut(V t) {
+    const float c4 = 2.0f * 3.14159265358979f / 3.0f;
+    V result = exp2Approx(splat(-10.0f) * t) * sinApprox((splat(10.0f) * t - splat(0.75f)) * splat(c4)) + splat(1.0f);
+    result = select(equal(t, splat(0.0f)), splat(0.0f), result);
+    return select(equal(t, splat(1.0f)), splat(1.0f), result);
+}
+inline V easeElasticInOut(V t) {
+    const float c5 = 2.0f * 3.14159265358979f / 4.5f;
+    V wave = sinApprox((splat(20.0f) * t - splat(11.125f)) * splat(c5));
+    V in = splat(-0.5f) * exp2Approx(splat(20.0f) * t - splat(10.0f)) * wave;
+    V out = splat(0.5f) * exp2Approx(splat(-20.0f) * t + splat(10.0f)) * wave + splat(1.0f);
+    V result = select(less(t, splat(0.5f)), in, out);
+    result = select(equal(t, splat(0.0f)), splat(0.0f), result);
+    return select(equal(t, splat(1.0f)), splat(1.0f), result);
+}
+
+inline V easeBounceOut(V t) {
+    const float n1 = 7.5625f;
+    const float d1 = 2.75f;
+    V result = splat(n1) * square(t - splat(2.625f / d1)) + splat(0.984375f);
+    result = select(less(t, splat(2.5f / d1)), splat(n1) * square(t - splat(2.25f / d1)) + splat(0.9375f), result);
+    result = select(less(t, splat(2.0f / d1)), splat(n1) * square(t - splat(1.5f / d1)) + splat(0.75f), result);
+    return select(less(t, splat(1.0f / d1)), splat(n1) * square(t), result);
+}
+inline V easeBounceIn(V t) {
+    return outOf(easeBounceOut(splat(1.0f) - t));
+}
+inline V easeBounceInOut(V t) {
+    V in = outOf(easeBounceOut(splat(1.0f) - splat(2.0f) * t)) * splat(0.5f);
+    V out = (splat(1.0f) + easeBounceOut(splat(2.0f) * t - splat(1.0f))) * splat(0.5f);
+    return select(less(t, splat(0.5f)), in, out);
+}
+
+// CSS style cubic-bezier: find the curve parameter whose x is t, then return
+// its y. A few bisection steps bracket the root so the Newton steps after
+// them cannot run off on steep curves.
+inline V bezierX(V s, const CubicBezier& curve) {
+    return ((splat(curve.ax) * s + splat(curve.bx)) * s + splat(curve.cx)) * s;
+}
+
+inline V easeCubicBezier(V t, const CubicBezier& curve) {
+    V low = splat(0.0f);
+    V high = splat(1.0f);
+    for (int i = 0; i < 4; i++) {
+        V middle = (low + high) * splat(0.5f);
+        auto below = less(bezierX(middle, curve), t);
+        low = select(below, middle, low);
+        high = select(below, high, middle);
+    }
+    V s = (low + high) * splat(0.5f);
+    for (int i = 0; i < 4; i++) {
+        V slope = (splat(3.0f * curve.ax) * s + splat(2.0f * curve.bx)) * s + splat(curve.cx);
+        V step = (bezierX(s, curve) - t) / max(slope, splat(1e-6f));
+        s = min(max(s - step, low), high);
+    }
+    return ((splat(curve.ay) * s + splat(curve.by)) * s + splat(curve.cy)) * s;
+}
+
+inline V easeVector(uint8_t type, V t) {
+    switch (type) {
+        case EASE_QUAD_IN: return easeQuadIn(t);
+        case EASE_QUAD_OUT: return easeQuadOut(t);
+        case EASE_QUAD_IN_OUT: return easeQuadInOut(t);
+        case EASE_CUBIC_IN: return easeCubicIn(t);
+        case EASE_CUBIC_OUT: return easeCubicOut(t);
+        case EASE_CUBIC_IN_OUT: return easeCubicInOut(t);
+        case EASE_QUART_IN: return easeQuartIn(t);
+        case EASE_QUART_OUT: return easeQuartOut(t);
+        case EASE_QUART_IN_OUT: return easeQuartInOut(t);
+        case EASE_EXPO_IN: return easeExpoIn(t);
+        case EASE_EXPO_OUT: return easeExpoOut(t);
+        case EASE_EXPO_IN_OUT: return easeExpoInOut(t);
+        case EASE_BACK_IN: return easeBackIn(t);
+        case EASE_BACK_OUT: return easeBackOut(t);
+        case EASE_BACK_IN_OUT: return easeBackInOut(t);
+        case EASE_ELASTIC_IN: return easeElasticIn(t);
+        case EASE_ELASTIC_OUT: return easeElasticOut(t);
+        case EASE_ELASTIC_IN_OUT: return easeElasticInOut(t);
+        case EASE_BOUNCE_IN: return easeBounceIn(t);
+        case EASE_BOUNCE_OUT: return easeBounceOut(t);
+        case EASE_BOUNCE_IN_OUT: return easeBounceInOut(t);
+        default:
+            if (type >= EASE_CUBIC_BEZIER_FIRST && type - EASE_CUBIC_BEZIER_FIRST < static_cast<int>(cubicBezierCurves.size())) {
+                return easeCubicBezier(t, cubicBezierCurves[type - EASE_CUBIC_BEZIER_FIRST]);
+            }
+            return t; // Linear
+    }
+}
+
+// Ease count values of one curve, WIDTH at a time. The switch runs once per
+// vector, the branch is the same every time so it predicts perfectly.
+inline void easeBatch(uint8_t type, const float* t, float* out, size_t count) {
+    size_t i = 0;
+    for (; i + WIDTH <= count; i += WIDTH) {
+        store(out + i, easeVector(type, load(t + i)));
+    }
+    if (i < count) easing_scalar::easeBatch(type, t + i, out + i, count - i);
+}
@@ -22,152 +22,92 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
     lastY = ypos;
 }
 
-void RemoveModel(int index)
+void RemoveModel(ModelHandle handle)
 {
-    auto model = models[index];
-    GLuint VAO = std::get<0>(model); // Extract the VAO from the model tuple
-    glDeleteVertexArrays(1, &VAO);
-    models.erase(std::remove(models.begin(), models.end(), model), models.end());
+    if (!sceneStore.isValid(handle))
+    {
+        LOG_ERROR << "Invalid model handle: " << handle.index;
+        return;
+    }
+
+    removeModelBounds(sceneStore.indexOf(handle));
+    textureCache.release(sceneStore.texture(handle));
+    if (sceneStore.meshId(handle) != INVALID_MESH) {
+        releaseMesh(sceneStore.meshId(handle));
+    }
+    sceneStore.remove(handle);
+
+    // Drop any tweens still targeting the removed model
+    tweenEngine.stop(handle);
 }
 
-void MoveModel(int index, glm::vec3 newPosition, bool tween, float duration)
+void MoveModel(ModelHandle handle, glm::vec3 newPosition, bool tween, float duration, EaseType easing = EASE_LINEAR)
 {
-    if (index < 0 || index >= models.size())
+    if (!sceneStore.isValid(handle))
     {
-        std::cerr << "Invalid model index: " << index << std::endl;
+        LOG_ERROR << "Invalid model handle: " << handle.index;
         return;
     }
 
-    auto& model = models[index];
-    glm::vec3 currentPosition = std::get<1>(model).second;
-    glm::vec3 direction = newPosition - currentPosition;
-    float totalDistance = glm::length(direction);
     if (tween)
     {
-        needToTween_POS[index] = {currentPosition, newPosition, duration, 0.0f, totalDistance/duration};
+        tweenEngine.startPosition(handle, sceneStore.position(handle), newPosition, duration, easing);
     }
     else
     {
-        std::get<1>(model).second = newPosition;
+        sceneStore.position(handle) = newPosition;
+        sceneStore.markTransformDirty(sceneStore.indexOf(handle));
     }
 }
 
-void MoveModel(int index, glm::vec3 newPosition) {MoveModel(index, newPosition, false, 0);};
-void MoveModel(int index, glm::vec3 newPosition, bool tween) {MoveModel(index, newPosition, tween, 0);};
+void MoveModel(ModelHandle handle, glm::vec3 newPosition) {MoveModel(handle, newPosition, false, 0);};
+void MoveModel(ModelHandle handle, glm::vec3 newPosition, bool tween) {MoveModel(handle, newPosition, tween, 0);};
 
-void RotateModel(int index, glm::vec3 newRotation, bool tween, float duration)
+void RotateModel(ModelHandle handle, glm::vec3 newRotation, bool tween, float duration, EaseType easing = EASE_LINEAR)
 {
-    if (index < 0 || index >= models.size()) {
-        std::cerr << "Invalid model index: " << index << std::endl;
+    if (!sceneStore.isValid(handle)) {
+        LOG_ERROR << "Invalid model handle: " << handle.index;
         return;
     }
 
-    // Get the current model's rotation
-    auto& model = models[index];
-    glm::vec3 currentRotation = std::get<2>(std::get<2>(model)); // Assuming the rotation is stored here
-    glm::vec3 direction = newRotation - currentRotation;
-    float totalDistance = glm::length(direction);
-
+    // newRotation is an axis scaled by the angle, stored as a quaternion
+    glm::quat target = axisAngleRotation(newRotation);
     if (tween) {
-        // Initialize tweening parameters
-        needToTween[index] = {currentRotation, newRotation, duration, 0.0f, totalDistance};
+        // Start from the model's current rotation
+        tweenEngine.startRotation(handle, sceneStore.rotation(handle), target, duration, easing);
     } else {
         // Directly set the new rotation if not tweening
-        std::get<2>(std::get<2>(model)) = newRotation;
+        sceneStore.rotation(handle) = target;
+        sceneStore.markTransformDirty(sceneStore.indexOf(handle));
     }
 }
 
-void RotateModel(int index, glm::vec3 newRotation) {RotateModel(index, newRotation, false, 0);};
-void RotateModel(int index, glm::vec3 newRotation, bool tween) {RotateModel(index, newRotation, tween, 0);};
+void RotateModel(ModelHandle handle, glm::vec3 newRotation) {RotateModel(handle, newRotation, false, 0);};
+void RotateModel(ModelHandle handle, glm::vec3 newRotation, bool tween) {RotateModel(handle, newRotation, tween, 0);};
 
-void DoAllTweenRotate()
+// Cast a ray from the camera along its view direction and return the closest model it hits
+ModelHandle PickModel(const Camera& camera, float maxDistance = 100.0f)
 {
-    for (auto it = needToTween.begin(); it != needToTween.end(); ) {
-        auto& [index, tween] = *it;
-
-        // If this is the first update, calculate the angular speed
-        if (tween.elapsedTime == 0.0f) {
-            // Calculate the angular distance to rotate
-            glm::vec3 direction = tween.endRotation - tween.startRotation;
-            float totalAngle = glm::length(direction); // Total angular distance
-            tween.speed = totalAngle / tween.duration; // Compute angular speed
-        }
-
-        // Update elapsed time
-        tween.elapsedTime += currentDeltaTime;
-
-        // Calculate the angular distance to rotate this frame
-        float angleToRotate = tween.speed * currentDeltaTime;
-
-        // Calculate the current rotation
-        glm::vec3 currentRotation = std::get<2>(std::get<2>(models[index]));
-
-        // Determine if we can reach the target in this frame
-        if (glm::length(tween.endRotation - currentRotation) > angleToRotate) {
-            // Move towards the target by the calculated angle
-            glm::vec3 rotationStep = glm::normalize(tween.endRotation - currentRotation) * angleToRotate;
-            currentRotation += rotationStep; // Update current rotation
-        } else {
-            // Snap to the target rotation when within the distance threshold
-            currentRotation = tween.endRotation;
-            std::cout << "Tween complete for model " << index << std::endl;
-            it = needToTween.erase(it); // Remove the completed tween
-            continue; // Skip the increment as we've erased the element
-        }
-
-        // Update model rotation
-        auto& model = models[index];
-        std::get<2>(std::get<2>(model)) = currentRotation;
-
-        // Debug output
-        std::cout << "Current Rotation for model " << index << ": " << glm::to_string(currentRotation) << std::endl;
-
-        ++it; // Move to the next tween
+    updateDirtyTransforms(); // Models moved since the last frame
+
+    uint32_t slot;
+    float distance;
+    if (!sceneBvh.raycast(camera.getPosition(), camera.getFront(), maxDistance, slot, distance)) {
+        return ModelHandle{};
     }
+    return { slot, sceneStore.slotGenerations[slot] };
 }
 
-void DoAllTweenMove()
-{
-    for (auto it = needToTween_POS.begin(); it != needToTween_POS.end(); ) {
-        auto& [index, tween] = *it;
-
-        // Get the current position
-        glm::vec3 currentPos = std::get<1>(models[index]).second;
-
-        // Calculate the total distance to the target position
-        glm::vec3 direction = tween.endRotation - tween.startRotation;
-        float totalDistance = glm::length(direction);
-
-        // If speed is not already set, calculate it based on duration
-        if (tween.elapsedTime == 0.0f) {
-            tween.speed = totalDistance / tween.duration; // Compute speed
-        }
-
-        // Normalize the direction
-        direction = glm::normalize(direction);
-
-        // Calculate the distance to move this frame
-        float distanceToMove = tween.speed * currentDeltaTime;
-
-        // Check if we can reach the target in this frame
-        if (glm::distance(currentPos, tween.endRotation) > distanceToMove) {
-            // Move the object a fixed distance in the direction of the target
-            currentPos += direction * distanceToMove;
-        } else {
-            // Snap to the target position when within the distance threshold
-            currentPos = tween.endRotation; 
-            std::cout << "Tween complete for model " << index << std::endl;
-            it = needToTween_POS.erase(it); // Remove the completed tween
-            continue; // Skip the increment, as we have erased the element
-        }
-
-        // Update model position
-        std::get<1>(models[index]).second = currentPos;
-
-        // Update elapsed time
-        tween.elapsedTime += currentDeltaTime;
-
-        ++it; // Move to the next tween
+ModelHandle pickedModel;
+
+// Left click picks the model under the crosshair
+void mouseButtonCallback(GLFWwindow* window, int button, int action, int /*mods*/) {
+    if (!locked || button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS) return;
+
+    Camera* camera = static_cast<Camera*>(glfwGetWindowUserPointer(window));
+    pickedModel = PickModel(*camera);
+    if (sceneStore.isValid(pickedModel)) {
+        LOG_INFO << "INFO::PICK Picked model " << pickedModel.index;
     }
 }
 
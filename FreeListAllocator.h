@@ -0,0 +1,90 @@
+#pragma once
+#include <map>
+#include <cstdint>
+#include <algorithm>
+
+// Hands out ranges of a linear space (vertices or indices of a shared buffer).
+// Free blocks are kept by offset so neighbors merge when a range comes back,
+// and by size so allocation takes the smallest block that fits. No GL here.
+struct FreeListAllocator {
+    static constexpr uint32_t INVALID_OFFSET = UINT32_MAX;
+
+    uint32_t capacity = 0;
+    uint32_t used = 0;
+    std::map<uint32_t, uint32_t> freeByOffset;     // offset -> size
+    std::multimap<uint32_t, uint32_t> freeBySize;  // size -> offset
+
+    // Returns the offset of a range of the given size, or INVALID_OFFSET if no block fits
+    uint32_t allocate(uint32_t size) {
+        if (size == 0) return 0;
+        auto best = freeBySize.lower_bound(size);
+        if (best == freeBySize.end()) return INVALID_OFFSET;
+
+        uint32_t blockSize = best->first;
+        uint32_t offset = best->second;
+        freeBySize.erase(best);
+        freeByOffset.erase(offset);
+        if (blockSize > size) addBlock(offset + size, blockSize - size);
+        used += size;
+        return offset;
+    }
+
+    void free(uint32_t offset, uint32_t size) {
+        if (size == 0) return;
+        used -= size;
+
+        // Merge with the blocks right before and right after
+        auto next = freeByOffset.lower_bound(offset);
+        if (next != freeByOffset.end() && offset + size == next->first) {
+            size += next->second;
+            removeBlock(next->first, next->second);
+        }
+        auto previous = freeByOffset.lower_bound(offset);
+        if (previous != freeByOffset.begin()) {
+            --previous;
+            if (previous->first + previous->second == offset) {
+                offset = previous->first;
+                size += previous->second;
+                removeBlock(previous->first, previous->second);
+            }
+        }
+        addBlock(offset, size);
+    }
+
+    // Extend the space, the new tail is free
+    void grow(uint32_t newCapacity) {
+        if (newCapacity <= capacity) return;
+        uint32_t oldCapacity = capacity;
+        capacity = newCapacity;
+        used += newCapacity - oldCapacity; // free() takes it back off
+        free(oldCapacity, newCapacity - oldCapacity);
+    }
+
+    uint32_t largestFreeBlock() const {
+        return freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+    }
+
+    void reset() {
+        capacity = 0;
+        used = 0;
+        freeByOffset.clear();
+        freeBySize.clear();
+    }
+
+private:
+    void addBlock(uint32_t offset, uint32_t size) {
+        freeByOffset[offset] = size;
+        freeBySize.insert({ size, offset });
+    }
+
+    void removeBlock(uint32_t offset, uint32_t size) {
+        freeByOffset.erase(offset);
+        auto range = freeBySize.equal_range(size);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == offset) {
+                freeBySize.erase(it);
+                break;
+            }
+        }
+    }
+};
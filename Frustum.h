@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <glm/glm.hpp>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRUSTUM_USE_SSE 1
+#endif
+
+// Six planes (left, right, bottom, top, near, far) as ax + by + cz + d >= 0 for points inside
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+// Gribb/Hartmann plane extraction from a projection * view matrix
+Frustum extractFrustum(const glm::mat4& viewProjection) {
+    Frustum frustum;
+    glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row3 + row2;
+    frustum.planes[5] = row3 - row2;
+
+    // Normalize so the plane distance can be compared against a radius
+    for (glm::vec4& plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) plane = plane / length;
+    }
+    return frustum;
+}
+
+bool sphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius) {
+    for (const glm::vec4& plane : frustum.planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) return false;
+    }
+    return true;
+}
+
+// Test spheres stored as separate x/y/z/radius arrays and append the indices
+// of the visible ones. Four spheres are tested per iteration when SSE is available.
+void cullSpheres(const Frustum& frustum, const float* x, const float* y, const float* z, const float* radius, size_t count, std::vector<uint32_t>& visible) {
+    size_t i = 0;
+#ifdef FRUSTUM_USE_SSE
+    __m128 planeA[6], planeB[6], planeC[6], planeD[6];
+    for (int p = 0; p < 6; p++) {
+        planeA[p] = _mm_set1_ps(frustum.planes[p].x);
+        planeB[p] = _mm_set1_ps(frustum.planes[p].y);
+        planeC[p] = _mm_set1_ps(frustum.planes[p].z);
+        planeD[p] = _mm_set1_ps(frustum.planes[p].w);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pz = _mm_loadu_ps(z + i);
+        __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+        // A lane stays visible while it is in front of every plane
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeA[p], px), _mm_mul_ps(planeB[p], py)),
+                                         _mm_add_ps(_mm_mul_ps(planeC[p], pz), planeD[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        if (mask == 0) continue;
+        for (int lane = 0; lane < 4; lane++) {
+            if (mask & (1 << lane)) visible.push_back(static_cast<uint32_t>(i + lane));
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        if (sphereInFrustum(frustum, glm::vec3(x[i], y[i], z[i]), radius[i])) {
+            visible.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
@@ -0,0 +1,256 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <GL/glew.h>
+
+// Thin layer over the GL calls that set binding and fixed-function state. It
+// remembers what was last set and drops calls that would not change anything,
+// which matters most on software GL where every call costs driver time.
+// Everything that binds or deletes GL objects goes through glState so the
+// cached values stay true. GL thread only.
+struct GLStateCache {
+    static constexpr GLuint UNKNOWN = UINT32_MAX;
+    static constexpr int TEXTURE_UNITS = 8;
+
+    // Buffer targets that are tracked; the element buffer belongs to the VAO
+    enum BufferSlot {
+        ARRAY_SLOT,
+        ELEMENT_ARRAY_SLOT,
+        UNIFORM_SLOT,
+        COPY_READ_SLOT,
+        COPY_WRITE_SLOT,
+        PIXEL_UNPACK_SLOT,
+        DRAW_INDIRECT_SLOT,
+        BUFFER_SLOT_COUNT
+    };
+
+    // Capabilities that are tracked, the rest pass straight through
+    enum CapSlot {
+        DEPTH_TEST_SLOT,
+        CULL_FACE_SLOT,
+        BLEND_SLOT,
+        SCISSOR_TEST_SLOT,
+        CAP_SLOT_COUNT
+    };
+
+    GLuint program = UNKNOWN;
+    GLuint vertexArray = UNKNOWN;
+    GLuint activeTextureUnit = UNKNOWN;
+    GLuint textures[TEXTURE_UNITS];
+    GLuint buffers[BUFFER_SLOT_COUNT];
+    int caps[CAP_SLOT_COUNT]; // -1 unknown, 0 disabled, 1 enabled
+    GLenum blendSource = UNKNOWN, blendDestination = UNKNOWN;
+    GLenum depthFunction = UNKNOWN;
+    int depthWrite = -1;
+    GLenum cullFaceMode = UNKNOWN;
+
+    // Calls made and calls dropped, the last frame's totals are kept for display
+    size_t issued = 0;
+    size_t skipped = 0;
+    size_t issuedLastFrame = 0;
+    size_t skippedLastFrame = 0;
+
+    GLStateCache() {
+        invalidate();
+    }
+
+    // Forget everything, the next call of each kind is issued
+    void invalidate() {
+        program = vertexArray = activeTextureUnit = UNKNOWN;
+        for (GLuint& texture : textures) texture = UNKNOWN;
+        for (GLuint& buffer : buffers) buffer = UNKNOWN;
+        for (int& cap : caps) cap = -1;
+        blendSource = blendDestination = depthFunction = cullFaceMode = UNKNOWN;
+        depthWrite = -1;
+    }
+
+    void beginFrame() {
+        issuedLastFrame = issued;
+        skippedLastFrame = skipped;
+        issued = 0;
+        skipped = 0;
+    }
+
+    // Each setter returns whether it reached GL
+    bool useProgram(GLuint id) {
+        if (!changed(program, id)) return false;
+        glUseProgram(id);
+        return true;
+    }
+
+    bool bindVertexArray(GLuint id) {
+        if (!changed(vertexArray, id)) return false;
+        glBindVertexArray(id);
+        buffers[ELEMENT_ARRAY_SLOT] = UNKNOWN; // Comes with the VAO
+        return true;
+    }
+
+    bool activeTexture(GLuint unit) {
+        if (!changed(activeTextureUnit, unit)) return false;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        return true;
+    }
+
+    // Binds a 2D texture on the given unit, switching the active unit if needed
+    bool bindTexture(GLuint unit, GLuint texture) {
+        if (textures[unit] == texture) {
+            skipped++;
+            return false;
+        }
+        activeTexture(unit);
+        textures[unit] = texture;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        issued++;
+        return true;
+    }
+
+    bool bindBuffer(GLenum target, GLuint buffer) {
+        int slot = bufferSlot(target);
+        if (slot < 0) {
+            glBindBuffer(target, buffer);
+            issued++;
+            return true;
+        }
+        if (!changed(buffers[slot], buffer)) return false;
+        glBindBuffer(target, buffer);
+        return true;
+    }
+
+    // Indexed binds are always issued, they also set the generic binding
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+        glBindBufferBase(target, index, buffer);
+        issued++;
+        int slot = bufferSlot(target);
+        if (slot >= 0) buffers[slot] = buffer;
+    }
+
+    bool enable(GLenum cap) {
+        return setCap(cap, true);
+    }
+
+    bool disable(GLenum cap) {
+        return setCap(cap, false);
+    }
+
+    bool blendFunc(GLenum source, GLenum destination) {
+        if (blendSource == source && blendDestination == destination) {
+            skipped++;
+            return false;
+        }
+        blendSource = source;
+        blendDestination = destination;
+        glBlendFunc(source, destination);
+        issued++;
+        return true;
+    }
+
+    bool depthFunc(GLenum function) {
+        if (!changed(depthFunction, function)) return false;
+        glDepthFunc(function);
+        return true;
+    }
+
+    bool depthMask(bool write) {
+        if (depthWrite == static_cast<int>(write)) {
+            skipped++;
+            return false;
+        }
+        depthWrite = write;
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+        issued++;
+        return true;
+    }
+
+    bool cullFace(GLenum mode) {
+        if (!changed(cullFaceMode, mode)) return false;
+        glCullFace(mode);
+        return true;
+    }
+
+    // Deleting a bound object resets its bindings to 0 in GL, mirror that so a
+    // reused name is not mistaken for the deleted object
+    void deleteProgram(GLuint id) {
+        if (id == 0) return;
+        glDeleteProgram(id);
+        if (program == id) program = UNKNOWN; // Stays in use until another program is bound
+    }
+
+    void deleteVertexArray(GLuint& id) {
+        if (id == 0) return;
+        glDeleteVertexArrays(1, &id);
+        if (vertexArray == id) {
+            vertexArray = 0;
+            buffers[ELEMENT_ARRAY_SLOT] = UNKNOWN;
+        }
+        id = 0;
+    }
+
+    void deleteBuffer(GLuint& id) {
+        if (id == 0) return;
+        glDeleteBuffers(1, &id);
+        for (GLuint& buffer : buffers) {
+            if (buffer == id) buffer = 0;
+        }
+        id = 0;
+    }
+
+    void deleteTexture(GLuint id) {
+        if (id == 0) return;
+        glDeleteTextures(1, &id);
+        for (GLuint& texture : textures) {
+            if (texture == id) texture = 0;
+        }
+    }
+
+private:
+    bool changed(GLuint& current, GLuint value) {
+        if (current == value) {
+            skipped++;
+            return false;
+        }
+        current = value;
+        issued++;
+        return true;
+    }
+
+    static int bufferSlot(GLenum target) {
+        switch (target) {
+            case GL_ARRAY_BUFFER: return ARRAY_SLOT;
+            case GL_ELEMENT_ARRAY_BUFFER: return ELEMENT_ARRAY_SLOT;
+            case GL_UNIFORM_BUFFER: return UNIFORM_SLOT;
+            case GL_COPY_READ_BUFFER: return COPY_READ_SLOT;
+            case GL_COPY_WRITE_BUFFER: return COPY_WRITE_SLOT;
+            case GL_PIXEL_UNPACK_BUFFER: return PIXEL_UNPACK_SLOT;
+            case GL_DRAW_INDIRECT_BUFFER: return DRAW_INDIRECT_SLOT;
+            default: return -1;
+        }
+    }
+
+    static int capSlot(GLenum cap) {
+        switch (cap) {
+            case GL_DEPTH_TEST: return DEPTH_TEST_SLOT;
+            case GL_CULL_FACE: return CULL_FACE_SLOT;
+            case GL_BLEND: return BLEND_SLOT;
+            case GL_SCISSOR_TEST: return SCISSOR_TEST_SLOT;
+            default: return -1;
+        }
+    }
+
+    bool setCap(GLenum cap, bool enabled) {
+        int slot = capSlot(cap);
+        if (slot >= 0 && caps[slot] == static_cast<int>(enabled)) {
+            skipped++;
+            return false;
+        }
+        if (slot >= 0) caps[slot] = enabled;
+        if (enabled) {
+            glEnable(cap);
+        } else {
+            glDisable(cap);
+        }
+        issued++;
+        return true;
+    }
+};
+
+GLStateCache glState;
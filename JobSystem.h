@@ -0,0 +1,172 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+
+// Worker threads for loading jobs, plus a queue of tasks that have to run on
+// the thread that owns the GL context (uploads, registry updates)
+struct JobSystem {
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex jobMutex;
+    std::condition_variable jobAvailable;
+    bool stopping = false;
+
+    std::deque<std::function<void()>> mainThreadTasks;
+    std::mutex mainThreadMutex;
+
+    // Defaults to one worker per core, leaving one for the render thread
+    void start(unsigned int workerCount = 0) {
+        if (workerCount == 0) {
+            unsigned int cores = std::thread::hardware_concurrency();
+            workerCount = cores > 1 ? cores - 1 : 1;
+        }
+        stopping = false;
+        for (unsigned int i = 0; i < workerCount; i++) {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    // Finish the running jobs, drop the queued ones and join the workers
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            stopping = true;
+            jobs.clear();
+        }
+        jobAvailable.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        mainThreadTasks.clear();
+    }
+
+    void submit(std::function<void()> job) {
+        // Without workers the job runs inline
+        if (workers.empty()) {
+            job();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            jobs.push_back(std::move(job));
+        }
+        jobAvailable.notify_one();
+    }
+
+    void runOnMainThread(std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        mainThreadTasks.push_back(std::move(task));
+    }
+
+    // Run queued main-thread tasks until the time budget is spent, the rest wait for the next frame.
+    // Tasks queued while this runs (including ones that re-queue themselves) wait as well.
+    void processMainThreadTasks(double budgetSeconds) {
+        auto start = std::chrono::steady_clock::now();
+        size_t remaining;
+        {
+            std::lock_guard<std::mutex> lock(mainThreadMutex);
+            remaining = mainThreadTasks.size();
+        }
+        while (remaining-- > 0) {
+            std::function<void()> task;
+            {
+                std::lock_guard<std::mutex> lock(mainThreadMutex);
+                if (mainThreadTasks.empty()) return;
+                task = std::move(mainThreadTasks.front());
+                mainThreadTasks.pop_front();
+            }
+            task();
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() >= budgetSeconds) return;
+        }
+    }
+
+private:
+    void workerLoop() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(jobMutex);
+                jobAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+
+JobSystem jobSystem;
+
+// Fixed-capacity queue between threads. Producers block while it is full,
+// which caps how much finished work can pile up before the consumer gets to it.
+template<typename T>
+struct BoundedQueue {
+    std::deque<T> items;
+    size_t capacity;
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    bool closed = false;
+
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    // Returns false if the queue was closed while waiting
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this]() { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool tryPop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Blocks until an item arrives, returns false once closed and drained
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Wake every waiter and drop what is left
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            items.clear();
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    void reopen() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = false;
+    }
+};
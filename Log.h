@@ -0,0 +1,232 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <charconv>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <algorithm>
+
+// Leveled logging without iostreams on the calling thread. A message is
+// formatted into a fixed slot of a lock-free ring buffer and a background
+// thread writes it out, so logging from the frame loop or from jobs never
+// waits on the console. Usage reads like the streams it replaces:
+//
+//   LOG_INFO << "INFO::MESH-CACHE Mapped cache for: " << path;
+//
+// Levels below LOG_MIN_LEVEL compile away, build with -DLOG_MIN_LEVEL=0 to
+// get debug output. Each call site logs at most LOG_RATE_LIMIT messages a
+// second, the rest are counted and reported with the next one that gets out.
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_RATE_LIMIT
+#define LOG_RATE_LIMIT 32
+#endif
+
+const size_t LOG_MESSAGE_BYTES = 1000;
+const size_t LOG_QUEUE_SLOTS = 256; // Power of two
+
+inline int64_t logMilliseconds() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Per call site budget of messages per second
+struct LogRateLimiter {
+    std::atomic<int64_t> windowStart{ 0 };
+    std::atomic<uint32_t> sent{ 0 };
+    std::atomic<uint32_t> suppressed{ 0 };
+
+    bool allow() {
+        int64_t now = logMilliseconds();
+        int64_t start = windowStart.load(std::memory_order_relaxed);
+        if (now - start >= 1000 && windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+            sent.store(0, std::memory_order_relaxed);
+        }
+        if (sent.fetch_add(1, std::memory_order_relaxed) < LOG_RATE_LIMIT) return true;
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint32_t takeSuppressed() {
+        return suppressed.exchange(0, std::memory_order_relaxed);
+    }
+};
+
+// Bounded multi-producer queue (Vyukov): every slot carries a sequence number
+// that says whether it is free for the producer at that position or ready
+// for the consumer. Producers claim positions with one CAS; a full queue
+// drops the message instead of waiting.
+struct Logger {
+    struct Slot {
+        std::atomic<size_t> sequence;
+        int level;
+        uint32_t length;
+        char text[LOG_MESSAGE_BYTES];
+    };
+
+    Slot slots[LOG_QUEUE_SLOTS];
+    std::atomic<size_t> enqueuePosition{ 0 };
+    size_t dequeuePosition = 0; // Drain thread only
+    std::atomic<uint32_t> dropped{ 0 };
+    std::atomic<bool> running{ true };
+    std::thread drainThread;
+
+    Logger() {
+        for (size_t i = 0; i < LOG_QUEUE_SLOTS; i++) slots[i].sequence.store(i, std::memory_order_relaxed);
+        drainThread = std::thread([this] { drain(); });
+    }
+
+    // Writes out whatever is still queued before the program ends
+    ~Logger() {
+        running.store(false, std::memory_order_release);
+        if (drainThread.joinable()) drainThread.join();
+    }
+
+    void push(int level, const char* text, size_t length) {
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[position & (LOG_QUEUE_SLOTS - 1)];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            } else if (difference < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        slot->level = level;
+        slot->length = static_cast<uint32_t>(length);
+        std::memcpy(slot->text, text, length);
+        slot->sequence.store(position + 1, std::memory_order_release);
+    }
+
+private:
+    bool pop(Slot*& slot) {
+        slot = &slots[dequeuePosition & (LOG_QUEUE_SLOTS - 1)];
+        return slot->sequence.load(std::memory_order_acquire) == dequeuePosition + 1;
+    }
+
+    void release(Slot* slot) {
+        slot->sequence.store(dequeuePosition + LOG_QUEUE_SLOTS, std::memory_order_release);
+        dequeuePosition++;
+    }
+
+    void drain() {
+        for (;;) {
+            bool stopping = !running.load(std::memory_order_acquire);
+            bool wroteOut = false, wroteErr = false;
+            Slot* slot;
+            while (pop(slot)) {
+                FILE* stream = slot->level >= LOG_LEVEL_WARN ? stderr : stdout;
+                std::fwrite(slot->text, 1, slot->length, stream);
+                std::fputc('\n', stream);
+                (stream == stderr ? wroteErr : wroteOut) = true;
+                release(slot);
+            }
+            uint32_t lost = dropped.exchange(0, std::memory_order_relaxed);
+            if (lost > 0) {
+                std::fprintf(stderr, "WARN::LOG Queue full, %u messages dropped\n", lost);
+                wroteErr = true;
+            }
+            if (wroteOut) std::fflush(stdout);
+            if (wroteErr) std::fflush(stderr);
+            if (stopping) return;
+            if (!wroteOut && !wroteErr) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+};
+
+Logger logger;
+
+// One message being built on the caller's stack, queued when the statement ends
+struct LogLine {
+    int level;
+    size_t length = 0;
+    char text[LOG_MESSAGE_BYTES];
+
+    LogLine(int level, LogRateLimiter& limiter) : level(level) {
+        uint32_t suppressed = limiter.takeSuppressed();
+        if (suppressed > 0) {
+            *this << "(" << suppressed << " similar messages suppressed) ";
+        }
+    }
+
+    ~LogLine() {
+        logger.push(level, text, length);
+    }
+
+    LogLine& operator<<(const char* value) {
+        if (value == nullptr) value = "(null)";
+        append(value, std::strlen(value));
+        return *this;
+    }
+
+    LogLine& operator<<(const unsigned char* value) {
+        return *this << reinterpret_cast<const char*>(value);
+    }
+
+    LogLine& operator<<(const std::string& value) {
+        append(value.data(), value.size());
+        return *this;
+    }
+
+    LogLine& operator<<(char value) {
+        append(&value, 1);
+        return *this;
+    }
+
+    LogLine& operator<<(bool value) {
+        return *this << (value ? "true" : "false");
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    LogLine& operator<<(T value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        append(digits, result.ptr - digits);
+        return *this;
+    }
+
+    LogLine& operator<<(double value) {
+        char digits[32];
+        int count = std::snprintf(digits, sizeof(digits), "%g", value);
+        if (count > 0) append(digits, std::min(static_cast<size_t>(count), sizeof(digits) - 1));
+        return *this;
+    }
+
+private:
+    // Long messages are cut off rather than split
+    void append(const char* source, size_t count) {
+        count = std::min(count, LOG_MESSAGE_BYTES - length);
+        std::memcpy(text + length, source, count);
+        length += count;
+    }
+};
+
+// A loop that runs once or not at all, so the macro can be followed by << and
+// still sits safely inside an unbraced if/else. The lambda gives every call
+// site its own static limiter.
+#define LOG_AT(LEVEL) \
+    for (LogRateLimiter* logSite_ = (LEVEL) < LOG_MIN_LEVEL ? nullptr : []() { static LogRateLimiter limiter; return limiter.allow() ? &limiter : nullptr; }(); \
+         logSite_ != nullptr; logSite_ = nullptr) \
+        LogLine(LEVEL, *logSite_)
+
+#define LOG_DEBUG LOG_AT(LOG_LEVEL_DEBUG)
+#define LOG_INFO LOG_AT(LOG_LEVEL_INFO)
+#define LOG_WARN LOG_AT(LOG_LEVEL_WARN)
+#define LOG_ERROR LOG_AT(LOG_LEVEL_ERROR)
@@ -0,0 +1,91 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file, memory-mapped where the platform allows it
+struct MappedFile {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    std::vector<unsigned char> buffer;
+#endif
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) return false;
+        std::fseek(file, 0, SEEK_END);
+        long length = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        if (length <= 0) {
+            std::fclose(file);
+            return false;
+        }
+        buffer.resize(static_cast<size_t>(length));
+        size_t read = std::fread(buffer.data(), 1, buffer.size(), file);
+        std::fclose(file);
+        if (read != buffer.size()) {
+            buffer.clear();
+            return false;
+        }
+        data = buffer.data();
+        size = buffer.size();
+        return true;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+        void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // The mapping stays valid after the descriptor is closed
+        if (mapping == MAP_FAILED) return false;
+        data = static_cast<const unsigned char*>(mapping);
+        size = static_cast<size_t>(info.st_size);
+        return true;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        buffer.clear();
+        buffer.shrink_to_fit();
+#else
+        if (data) munmap(const_cast<unsigned char*>(data), size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+};
+
+// 64-bit FNV-1a
+uint64_t hashBytes(const unsigned char* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool hashFile(const std::string& path, uint64_t& hash) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+    hash = hashBytes(file.data, file.size);
+    return true;
+}
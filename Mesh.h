@@ -0,0 +1,399 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include "Texture.h"
+#include "FreeListAllocator.h"
+#include "GLStateCache.h"
+#include "Log.h"
+
+// Full precision vertex used while importing and stored in the mesh cache
+struct Vertex {
+    glm::vec3 position;
+    glm::vec2 texCoord;
+    glm::vec3 normal;
+};
+
+// Quantized GPU vertex, 16 bytes instead of 32
+struct PackedVertex {
+    uint16_t position[4]; // Normalized within the mesh AABB, w is padding
+    uint16_t texCoord[2]; // Half floats
+    int16_t normal[2];    // Octahedral, normalized
+};
+
+// GPU vertex for meshes uploaded without quantization
+struct FloatVertex {
+    glm::vec3 position;
+    glm::vec2 texCoord;
+    glm::vec2 normal; // Octahedral
+};
+
+// Upload new meshes as PackedVertex, turn off when 16-bit positions are too coarse
+bool quantizeVertices = true;
+
+const GLuint NORMAL_LOCATION = 7;
+
+// Local-space bounds of a mesh
+struct MeshBounds {
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    glm::vec3 sphereCenter = glm::vec3(0.0f);
+    float sphereRadius = 0.0f;
+};
+
+// Per-instance data streamed to the vertex shader (locations 2-6)
+struct InstanceData {
+    glm::mat4 model;
+    glm::vec4 color;
+};
+
+const GLuint INSTANCE_MODEL_LOCATION = 2; // mat4 takes locations 2-5
+const GLuint INSTANCE_COLOR_LOCATION = 6;
+
+// Index range of one level of detail, every level shares the mesh's vertices
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error; // Largest deviation from the full mesh, in model units
+};
+
+const int MAX_MESH_LODS = 4;
+
+// One part of a file with its own material. Its vertices start at baseVertex
+// in the geometry arena and its indices are relative to that.
+struct Submesh {
+    uint32_t baseVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t lodCount = 1;
+    MeshLod lods[MAX_MESH_LODS] = {}; // Level 0 is the full part
+    bool hasMaterial = false;
+    glm::vec3 materialColor = glm::vec3(0.0f);
+    GLuint textureID = 0; // Diffuse texture from the material
+};
+
+// Geometry uploaded once per file and shared by every model loaded from it.
+// Its vertices and indices are ranges of the geometry arena for its vertex format.
+struct Mesh {
+    std::string path;
+    bool quantized = false; // Picks the arena
+    uint32_t firstVertex = 0; // Ranges in the arena, the submesh offsets already include them
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    std::vector<Submesh> submeshes;
+    uint32_t lodCount = 1; // Most levels any submesh has
+    MeshBounds bounds;
+    glm::mat4 dequantize = glm::mat4(1.0f); // Maps quantized positions back to model space, folded into the instance matrix
+
+    int refCount = 0;
+};
+
+// Mesh registry keyed by file path
+std::vector<Mesh> meshes;
+std::vector<uint32_t> freeMeshIds;
+std::unordered_map<std::string, uint32_t> meshByPath;
+
+const uint32_t INVALID_MESH = UINT32_MAX;
+
+// Returns the id of an already loaded mesh and takes a reference to it
+uint32_t acquireMesh(const std::string& path) {
+    auto it = meshByPath.find(path);
+    if (it == meshByPath.end()) return INVALID_MESH;
+    meshes[it->second].refCount++;
+    return it->second;
+}
+
+// Store a freshly uploaded mesh with one reference
+uint32_t registerMesh(Mesh mesh) {
+    uint32_t id;
+    if (!freeMeshIds.empty()) {
+        id = freeMeshIds.back();
+        freeMeshIds.pop_back();
+    } else {
+        id = static_cast<uint32_t>(meshes.size());
+        meshes.emplace_back();
+    }
+    mesh.refCount = 1;
+    meshByPath[mesh.path] = id;
+    meshes[id] = std::move(mesh);
+    return id;
+}
+
+// AABB around the vertices and a sphere centered on it
+MeshBounds computeMeshBounds(const Vertex* vertices, size_t count) {
+    MeshBounds bounds;
+    if (count == 0) return bounds;
+    bounds.boundsMin = bounds.boundsMax = vertices[0].position;
+    for (size_t i = 0; i < count; i++) {
+        bounds.boundsMin = glm::min(bounds.boundsMin, vertices[i].position);
+        bounds.boundsMax = glm::max(bounds.boundsMax, vertices[i].position);
+    }
+    bounds.sphereCenter = (bounds.boundsMin + bounds.boundsMax) * 0.5f;
+
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 offset = vertices[i].position - bounds.sphereCenter;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    bounds.sphereRadius = std::sqrt(radiusSquared);
+    return bounds;
+}
+
+// Octahedral mapping of a unit vector onto [-1, 1]^2
+glm::vec2 octahedralEncode(glm::vec3 normal) {
+    normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    glm::vec2 encoded(normal.x, normal.y);
+    if (normal.z < 0.0f) {
+        encoded.x = (1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f);
+        encoded.y = (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return encoded;
+}
+
+// Size of the quantization box, flat meshes keep a tiny extent so nothing divides by zero
+glm::vec3 quantizationExtent(const MeshBounds& bounds) {
+    return glm::max(bounds.boundsMax - bounds.boundsMin, glm::vec3(1e-6f));
+}
+
+glm::mat4 dequantizeMatrix(const MeshBounds& bounds) {
+    return glm::scale(glm::translate(glm::mat4(1.0f), bounds.boundsMin), quantizationExtent(bounds));
+}
+
+uint16_t quantizeUnorm16(float value) {
+    return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+int16_t quantizeSnorm16(float value) {
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+// Quantize vertices for upload. The dequantize matrix scales by the extent,
+// so normals are stored divided by it and come out right after the shader
+// multiplies them by the instance matrix.
+void packVertices(const Vertex* vertices, size_t count, const MeshBounds& bounds, std::vector<PackedVertex>& packed) {
+    glm::vec3 extent = quantizationExtent(bounds);
+    packed.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const Vertex& vertex = vertices[i];
+        PackedVertex& out = packed[i];
+        glm::vec3 position = (vertex.position - bounds.boundsMin) / extent;
+        for (int c = 0; c < 3; c++) out.position[c] = quantizeUnorm16(position[c]);
+        out.position[3] = 0;
+        out.texCoord[0] = glm::packHalf1x16(vertex.texCoord.x);
+        out.texCoord[1] = glm::packHalf1x16(vertex.texCoord.y);
+
+        glm::vec3 normal = vertex.normal / extent;
+        float length = glm::length(normal);
+        glm::vec2 encoded = octahedralEncode(length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f));
+        out.normal[0] = quantizeSnorm16(encoded.x);
+        out.normal[1] = quantizeSnorm16(encoded.y);
+    }
+}
+
+void packFloatVertices(const Vertex* vertices, size_t count, std::vector<FloatVertex>& packed) {
+    packed.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        float length = glm::length(vertices[i].normal);
+        glm::vec3 normal = length > 0.0f ? vertices[i].normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+        packed[i] = { vertices[i].position, vertices[i].texCoord, octahedralEncode(normal) };
+    }
+}
+
+// Point the bound VAO's vertex attributes at the bound GL_ARRAY_BUFFER
+void pointVertexAttributes(bool quantized) {
+    if (quantized) {
+        const GLsizei stride = sizeof(PackedVertex);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (GLvoid*)offsetof(PackedVertex, position));
+        glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(PackedVertex, texCoord));
+        glVertexAttribPointer(NORMAL_LOCATION, 2, GL_SHORT, GL_TRUE, stride, (GLvoid*)offsetof(PackedVertex, normal));
+    } else {
+        const GLsizei stride = sizeof(FloatVertex);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(FloatVertex, position));
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(FloatVertex, texCoord));
+        glVertexAttribPointer(NORMAL_LOCATION, 2, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offsetof(FloatVertex, normal));
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(NORMAL_LOCATION);
+}
+
+// Instanced attributes advance once per instance, this is VAO state so it is set up once per arena
+void enableInstanceAttributes() {
+    for (GLuint i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + i);
+        glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + i, 1);
+    }
+    glEnableVertexAttribArray(INSTANCE_COLOR_LOCATION);
+    glVertexAttribDivisor(INSTANCE_COLOR_LOCATION, 1);
+}
+
+// Point the bound VAO's instanced attributes at a range of the bound GL_ARRAY_BUFFER
+void pointInstanceAttributes(size_t firstInstance) {
+    const GLsizei stride = sizeof(InstanceData);
+    const size_t base = firstInstance * sizeof(InstanceData);
+    for (GLuint i = 0; i < 4; i++) {
+        glVertexAttribPointer(INSTANCE_MODEL_LOCATION + i, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(base + i * sizeof(glm::vec4)));
+    }
+    glVertexAttribPointer(INSTANCE_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(base + offsetof(InstanceData, color)));
+}
+
+// Every mesh with the same vertex format shares one vertex buffer, one index
+// buffer and one VAO, so drawing only switches VAO between formats
+struct GeometryArena {
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    GLuint EBO = 0;
+    FreeListAllocator vertices;
+    FreeListAllocator indices;
+};
+
+GeometryArena geometryArenas[2]; // Float and quantized vertices
+
+// Starting sizes, an arena doubles whenever a mesh does not fit
+const uint32_t ARENA_INITIAL_VERTICES = 1 << 18;
+const uint32_t ARENA_INITIAL_INDICES = 1 << 20;
+
+GeometryArena& geometryArena(bool quantized) {
+    return geometryArenas[quantized ? 1 : 0];
+}
+
+size_t vertexStride(bool quantized) {
+    return quantized ? sizeof(PackedVertex) : sizeof(FloatVertex);
+}
+
+// Copy a buffer into a new, larger one and delete the old one
+GLuint growBuffer(GLuint buffer, size_t oldBytes, size_t newBytes) {
+    GLuint grown;
+    glGenBuffers(1, &grown);
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, newBytes, NULL, GL_STATIC_DRAW);
+    if (buffer != 0) {
+        glState.bindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+        glState.deleteBuffer(buffer);
+    }
+    return grown;
+}
+
+// Next capacity that leaves a free tail of at least count
+uint32_t grownCapacity(const FreeListAllocator& allocator, uint32_t count, uint32_t initial) {
+    return std::max({ allocator.capacity * 2, allocator.capacity + count, initial });
+}
+
+// Make sure both ranges fit, growing the buffers and repointing the VAO if they had to move
+void reserveGeometry(GeometryArena& arena, bool quantized, uint32_t vertexCount, uint32_t indexCount) {
+    bool moved = false;
+    if (arena.vertices.largestFreeBlock() < vertexCount) {
+        uint32_t capacity = grownCapacity(arena.vertices, vertexCount, ARENA_INITIAL_VERTICES);
+        arena.VBO = growBuffer(arena.VBO, arena.vertices.capacity * vertexStride(quantized), capacity * vertexStride(quantized));
+        arena.vertices.grow(capacity);
+        moved = true;
+    }
+    if (arena.indices.largestFreeBlock() < indexCount) {
+        uint32_t capacity = grownCapacity(arena.indices, indexCount, ARENA_INITIAL_INDICES);
+        arena.EBO = growBuffer(arena.EBO, arena.indices.capacity * sizeof(GLuint), capacity * sizeof(GLuint));
+        arena.indices.grow(capacity);
+        moved = true;
+    }
+    if (!moved) return;
+
+    LOG_INFO << "INFO::GEOMETRY-ARENA " << (quantized ? "Quantized" : "Float") << " arena now holds "
+             << arena.vertices.capacity << " vertices and " << arena.indices.capacity << " indices";
+
+    // The VAO remembers buffer objects, so it has to see the new ones
+    if (arena.VAO == 0) glGenVertexArrays(1, &arena.VAO);
+    glState.bindVertexArray(arena.VAO);
+    glState.bindBuffer(GL_ARRAY_BUFFER, arena.VBO);
+    pointVertexAttributes(quantized);
+
+    // Per-instance transform and color, pointed at the instance buffer when drawing
+    enableInstanceAttributes();
+
+    glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.EBO);
+    glState.bindVertexArray(0);
+}
+
+// Copy a mesh's vertices and indices into its arena and record where they went
+void allocateGeometry(Mesh& mesh, const void* vertexData, uint32_t vertexCount, const GLuint* indexData, uint32_t indexCount) {
+    GeometryArena& arena = geometryArena(mesh.quantized);
+    reserveGeometry(arena, mesh.quantized, vertexCount, indexCount);
+
+    mesh.firstVertex = arena.vertices.allocate(vertexCount);
+    mesh.vertexCount = vertexCount;
+    mesh.firstIndex = arena.indices.allocate(indexCount);
+    mesh.indexCount = indexCount;
+
+    const size_t stride = vertexStride(mesh.quantized);
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, arena.VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, mesh.firstVertex * stride, vertexCount * stride, vertexData);
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, arena.EBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, mesh.firstIndex * sizeof(GLuint), indexCount * sizeof(GLuint), indexData);
+}
+
+void freeGeometry(const Mesh& mesh) {
+    GeometryArena& arena = geometryArena(mesh.quantized);
+    arena.vertices.free(mesh.firstVertex, mesh.vertexCount);
+    arena.indices.free(mesh.firstIndex, mesh.indexCount);
+}
+
+// Bytes in use and reserved across every arena
+size_t geometryBytesUsed() {
+    return geometryArenas[0].vertices.used * vertexStride(false) + geometryArenas[1].vertices.used * vertexStride(true)
+         + (geometryArenas[0].indices.used + geometryArenas[1].indices.used) * sizeof(GLuint);
+}
+
+size_t geometryBytesReserved() {
+    return geometryArenas[0].vertices.capacity * vertexStride(false) + geometryArenas[1].vertices.capacity * vertexStride(true)
+         + (geometryArenas[0].indices.capacity + geometryArenas[1].indices.capacity) * sizeof(GLuint);
+}
+
+void destroyGeometryArenas() {
+    for (GeometryArena& arena : geometryArenas) {
+        glState.deleteVertexArray(arena.VAO);
+        glState.deleteBuffer(arena.VBO);
+        glState.deleteBuffer(arena.EBO);
+        arena = GeometryArena();
+    }
+}
+
+// A model's own texture shows on the parts that have none from their material
+bool hasUntexturedSubmesh(const Mesh& mesh) {
+    for (const Submesh& submesh : mesh.submeshes) {
+        if (submesh.textureID == 0) return true;
+    }
+    return false;
+}
+
+void destroyMesh(Mesh& mesh) {
+    for (const Submesh& submesh : mesh.submeshes) {
+        textureCache.release(submesh.textureID);
+    }
+    freeGeometry(mesh);
+    mesh = Mesh();
+}
+
+// Drop a reference, the geometry and textures go away with the last one
+void releaseMesh(uint32_t id) {
+    Mesh& mesh = meshes[id];
+    if (--mesh.refCount > 0) return;
+    meshByPath.erase(mesh.path);
+    destroyMesh(mesh);
+    freeMeshIds.push_back(id);
+}
+
+void destroyAllMeshes() {
+    for (Mesh& mesh : meshes) {
+        if (mesh.refCount > 0) destroyMesh(mesh);
+    }
+    meshes.clear();
+    freeMeshIds.clear();
+    meshByPath.clear();
+}
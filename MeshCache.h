@@ -0,0 +1,134 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+#include <thread>
+#include <functional>
+#include "MappedFile.h"
+#include "Mesh.h"
+
+// Cache layout: header, submesh records, texture path strings (padded to 4
+// bytes), vertices, indices. Vertices are stored in the GPU upload format, so
+// a cache hit goes from the mapping to the buffer without a copy. Fields are
+// stored in native byte order, the cache is rebuilt if it does not match.
+const char MESH_CACHE_MAGIC[4] = { 'R', 'M', 'S', 'H' };
+const uint32_t MESH_CACHE_VERSION = 7;
+
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;    // Hash of the source model file
+    uint64_t sourceSize;    // Size and modification time of the source, while they
+    int64_t sourceModified; // match the source is not read to check the hash
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t vertexStride;
+    uint32_t quantized;     // PackedVertex if set, dequantized through the bounds below, else FloatVertex
+    uint32_t submeshCount;
+    uint32_t stringBytes;   // Texture paths of every submesh, back to back
+    float boundsMin[3];
+    float boundsMax[3];
+    float sphereCenter[3];
+    float sphereRadius;
+};
+
+struct MeshCacheSubmesh {
+    uint32_t baseVertex;
+    uint32_t vertexCount;
+    uint32_t lodCount;
+    uint32_t hasMaterial;
+    float materialColor[3];
+    uint32_t texturePathOffset; // Into the string section
+    uint32_t texturePathLength;
+    MeshLod lods[MAX_MESH_LODS]; // Index ranges, level 0 is the full part
+};
+
+// What the cache remembers of its source file
+struct MeshSource {
+    std::string path;
+    uint64_t size = 0;
+    int64_t modified = 0;
+};
+
+bool statMeshSource(const std::string& path, MeshSource& source) {
+    std::error_code error;
+    source.path = path;
+    source.size = std::filesystem::file_size(path, error);
+    if (error) return false;
+    source.modified = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    return !error;
+}
+
+std::string meshCachePath(const std::string& sourcePath) {
+    return sourcePath + ".meshcache";
+}
+
+size_t alignTo4(size_t size) {
+    return (size + 3) & ~static_cast<size_t>(3);
+}
+
+// Validate a mapped cache against its source and locate its sections. The
+// source is only hashed if its size or modification time changed. A cache
+// in the other vertex format counts as stale.
+bool parseMeshCache(const MappedFile& file, const MeshSource& source, bool quantized, MeshCacheHeader& header, const MeshCacheSubmesh*& submeshes, const char*& strings, const void*& vertices, const uint32_t*& indices) {
+    if (!file.data || file.size < sizeof(MeshCacheHeader)) return false;
+    std::memcpy(&header, file.data, sizeof(MeshCacheHeader));
+    if (std::memcmp(header.magic, MESH_CACHE_MAGIC, 4) != 0 || header.version != MESH_CACHE_VERSION) return false;
+    if ((header.quantized != 0) != quantized || header.vertexStride != vertexStride(quantized)) return false;
+
+    size_t submeshOffset = sizeof(MeshCacheHeader);
+    size_t stringOffset = submeshOffset + static_cast<size_t>(header.submeshCount) * sizeof(MeshCacheSubmesh);
+    size_t vertexOffset = stringOffset + alignTo4(header.stringBytes);
+    size_t indexOffset = vertexOffset + static_cast<size_t>(header.vertexCount) * header.vertexStride;
+    size_t end = indexOffset + static_cast<size_t>(header.indexCount) * sizeof(uint32_t);
+    if (end != file.size) return false;
+
+    submeshes = reinterpret_cast<const MeshCacheSubmesh*>(file.data + submeshOffset);
+    for (uint32_t s = 0; s < header.submeshCount; s++) {
+        const MeshCacheSubmesh& submesh = submeshes[s];
+        if (static_cast<uint64_t>(submesh.baseVertex) + submesh.vertexCount > header.vertexCount) return false;
+        if (static_cast<uint64_t>(submesh.texturePathOffset) + submesh.texturePathLength > header.stringBytes) return false;
+        if (submesh.lodCount == 0 || submesh.lodCount > MAX_MESH_LODS) return false;
+        for (uint32_t i = 0; i < submesh.lodCount; i++) {
+            if (static_cast<uint64_t>(submesh.lods[i].firstIndex) + submesh.lods[i].indexCount > header.indexCount) return false;
+        }
+    }
+
+    if (header.sourceSize != source.size || header.sourceModified != source.modified) {
+        uint64_t sourceHash;
+        if (!hashFile(source.path, sourceHash) || sourceHash != header.sourceHash) return false;
+    }
+
+    strings = reinterpret_cast<const char*>(file.data + stringOffset);
+    vertices = file.data + vertexOffset;
+    indices = reinterpret_cast<const uint32_t*>(file.data + indexOffset);
+    return true;
+}
+
+// Write through a temporary file so a reader never sees a half written cache
+bool writeMeshCache(const std::string& cachePath, const MeshCacheHeader& header, const std::vector<MeshCacheSubmesh>& submeshes, const std::string& strings, const void* vertices, const uint32_t* indices) {
+    std::string tempPath = cachePath + ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) return false;
+
+    const char padding[4] = { 0, 0, 0, 0 };
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && std::fwrite(submeshes.data(), sizeof(MeshCacheSubmesh), submeshes.size(), file) == submeshes.size();
+    ok = ok && std::fwrite(strings.data(), 1, strings.size(), file) == strings.size();
+    size_t paddingSize = alignTo4(strings.size()) - strings.size();
+    ok = ok && std::fwrite(padding, 1, paddingSize, file) == paddingSize;
+    ok = ok && std::fwrite(vertices, header.vertexStride, header.vertexCount, file) == header.vertexCount;
+    ok = ok && std::fwrite(indices, sizeof(uint32_t), header.indexCount, file) == header.indexCount;
+    ok = std::fclose(file) == 0 && ok;
+
+    std::error_code error;
+    if (ok) std::filesystem::rename(tempPath, cachePath, error);
+    if (!ok || error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
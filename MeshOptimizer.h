@@ -0,0 +1,255 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+
+// Import-time index and vertex reordering for the GPU's post-transform vertex
+// cache, overdraw and vertex fetch. Pure CPU work, safe on worker threads.
+
+const int VERTEX_CACHE_SIZE = 16;
+
+// Transformed vertices per triangle (ACMR) and per referenced vertex (ATVR)
+// for a FIFO cache of the given size. 0.5 and 1.0 are the best possible.
+struct VertexCacheStats {
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = VERTEX_CACHE_SIZE) {
+    VertexCacheStats stats;
+    if (indices.empty()) return stats;
+
+    // A vertex is in the FIFO if it was pushed less than cacheSize pushes ago
+    std::vector<uint32_t> pushedAt(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    uint32_t pushes = 0;
+    size_t misses = 0;
+    size_t unique = 0;
+    for (uint32_t index : indices) {
+        if (!referenced[index]) {
+            referenced[index] = true;
+            unique++;
+        }
+        if (pushedAt[index] == 0 || pushes - pushedAt[index] >= static_cast<uint32_t>(cacheSize)) {
+            pushedAt[index] = ++pushes;
+            misses++;
+        }
+    }
+    stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / unique;
+    return stats;
+}
+
+// Tipsify (Sander, Nehab and Barczak 2007): fan around a vertex, move to the
+// neighbor that is still in the cache and has triangles left. Returns the new
+// index order; clusterStarts receives the triangle index of every point where
+// the walk had to jump (a dead end), which the overdraw pass splits on.
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, std::vector<size_t>& clusterStarts, int cacheSize = VERTEX_CACHE_SIZE) {
+    size_t triangleCount = indices.size() / 3;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    clusterStarts.clear();
+    if (triangleCount == 0 || vertexCount == 0) return result;
+
+    // Vertex to triangle adjacency
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t index : indices) liveTriangles[index]++;
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    uint32_t time = cacheSize + 1;
+    size_t cursor = 0;
+
+    int64_t fanVertex = 0;
+    clusterStarts.push_back(0);
+    while (fanVertex >= 0) {
+        candidates.clear();
+        for (uint32_t a = adjacencyOffset[fanVertex]; a < adjacencyOffset[fanVertex + 1]; a++) {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle]) continue;
+            emitted[triangle] = true;
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = indices[triangle * 3 + k];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (time - cacheTime[v] > static_cast<uint32_t>(cacheSize)) {
+                    cacheTime[v] = time++;
+                }
+            }
+        }
+
+        // Prefer the candidate that stays in the cache the longest while its remaining fan is emitted
+        fanVertex = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (liveTriangles[v] == 0) continue;
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= static_cast<uint32_t>(cacheSize)) {
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanVertex = v;
+            }
+        }
+
+        if (fanVertex < 0) {
+            // Dead end: back up through recently used vertices, then scan for any vertex with triangles left
+            while (!deadEnds.empty() && fanVertex < 0) {
+                uint32_t v = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[v] > 0) fanVertex = v;
+            }
+            while (fanVertex < 0 && cursor < vertexCount) {
+                if (liveTriangles[cursor] > 0) fanVertex = static_cast<int64_t>(cursor);
+                cursor++;
+            }
+            if (fanVertex >= 0 && clusterStarts.back() != result.size() / 3) clusterStarts.push_back(result.size() / 3);
+        }
+    }
+    return result;
+}
+
+// Split the dead-end clusters further wherever restarting the cache costs
+// little, so there are enough clusters to sort, bounded by threshold times
+// the cluster's own ACMR
+void splitClusters(const std::vector<uint32_t>& indices, size_t vertexCount, std::vector<size_t>& clusterStarts, float threshold, int cacheSize = VERTEX_CACHE_SIZE) {
+    size_t triangleCount = indices.size() / 3;
+    std::vector<size_t> hardStarts = clusterStarts;
+    hardStarts.push_back(triangleCount);
+    clusterStarts.clear();
+
+    std::vector<uint32_t> pushedAt(vertexCount, 0);
+    uint32_t pushes = 0;
+    auto misses = [&](size_t triangle) {
+        int count = 0;
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = indices[triangle * 3 + k];
+            if (pushedAt[v] == 0 || pushes - pushedAt[v] >= static_cast<uint32_t>(cacheSize)) {
+                pushedAt[v] = ++pushes;
+                count++;
+            }
+        }
+        return count;
+    };
+    auto resetCache = [&]() { pushes += cacheSize; };
+
+    for (size_t c = 0; c + 1 < hardStarts.size(); c++) {
+        size_t start = hardStarts[c], end = hardStarts[c + 1];
+        resetCache();
+        size_t clusterMisses = 0;
+        for (size_t t = start; t < end; t++) clusterMisses += misses(t);
+        float limit = threshold * clusterMisses / (end - start);
+
+        resetCache();
+        clusterStarts.push_back(start);
+        size_t softStart = start;
+        size_t softMisses = 0;
+        for (size_t t = start; t < end; t++) {
+            softMisses += misses(t);
+            if (t + 1 < end && softMisses <= limit * (t - softStart + 1)) {
+                clusterStarts.push_back(t + 1);
+                softStart = t + 1;
+                softMisses = 0;
+                resetCache();
+            }
+        }
+    }
+}
+
+// Sort clusters so the ones facing away from the mesh center draw first;
+// they are most likely to be in front and hide the rest (Sander et al.)
+std::vector<uint32_t> optimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const std::vector<size_t>& clusterStarts) {
+    size_t triangleCount = indices.size() / 3;
+    if (clusterStarts.size() < 2) return indices;
+
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    struct Cluster {
+        size_t start;
+        size_t end;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters;
+    std::vector<glm::vec3> centers;
+    std::vector<glm::vec3> normals;
+
+    for (size_t c = 0; c < clusterStarts.size(); c++) {
+        size_t start = clusterStarts[c];
+        size_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+        glm::vec3 center(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = start; t < end; t++) {
+            const glm::vec3& a = vertices[indices[t * 3]].position;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& d = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 faceNormal = glm::cross(b - a, d - a); // Length is twice the area
+            float faceArea = glm::length(faceNormal);
+            center += (a + b + d) * (faceArea / 3.0f);
+            normal += faceNormal;
+            area += faceArea;
+        }
+        meshCenter += center;
+        meshArea += area;
+        centers.push_back(area > 0.0f ? center / area : vertices[indices[start * 3]].position);
+        normals.push_back(normal);
+        clusters.push_back({ start, end, 0.0f });
+    }
+    if (meshArea > 0.0f) meshCenter /= meshArea;
+
+    for (size_t c = 0; c < clusters.size(); c++) {
+        float length = glm::length(normals[c]);
+        clusters[c].sortKey = length > 0.0f ? glm::dot(centers[c] - meshCenter, normals[c] / length) : 0.0f;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const Cluster& cluster : clusters) {
+        result.insert(result.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+    }
+    return result;
+}
+
+// Renumber vertices in the order the indices first use them so fetches walk
+// the vertex buffer forward; unreferenced vertices are dropped
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+    for (uint32_t& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(reordered);
+}
+
+// Run every pass and return the cache stats before and after
+void optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, VertexCacheStats& before, VertexCacheStats& after, float overdrawThreshold = 1.05f) {
+    before = analyzeVertexCache(indices, vertices.size());
+
+    std::vector<size_t> clusterStarts;
+    indices = optimizeVertexCache(indices, vertices.size(), clusterStarts);
+    splitClusters(indices, vertices.size(), clusterStarts, overdrawThreshold);
+    indices = optimizeOverdraw(indices, vertices, clusterStarts);
+    optimizeVertexFetch(vertices, indices);
+
+    after = analyzeVertexCache(indices, vertices.size());
+}
+
+// Run the passes when importing models, the result is stored in the mesh cache
+bool optimizeMeshes = true;
@@ -0,0 +1,222 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+
+// Quadric error metric edge-collapse simplification (Garland and Heckbert).
+// Collapses move a vertex onto a neighbor, so every LOD indexes the same
+// vertex buffer and only needs its own index range. Safe on worker threads.
+
+// Symmetric 4x4 error matrix plus the total area of the planes summed into it
+struct Quadric {
+    double xx = 0, xy = 0, xz = 0, xw = 0;
+    double yy = 0, yz = 0, yw = 0;
+    double zz = 0, zw = 0;
+    double ww = 0;
+    double weight = 0;
+
+    void addPlane(double a, double b, double c, double d, double planeWeight) {
+        xx += planeWeight * a * a; xy += planeWeight * a * b; xz += planeWeight * a * c; xw += planeWeight * a * d;
+        yy += planeWeight * b * b; yz += planeWeight * b * c; yw += planeWeight * b * d;
+        zz += planeWeight * c * c; zw += planeWeight * c * d;
+        ww += planeWeight * d * d;
+        weight += planeWeight;
+    }
+
+    void add(const Quadric& other) {
+        xx += other.xx; xy += other.xy; xz += other.xz; xw += other.xw;
+        yy += other.yy; yz += other.yz; yw += other.yw;
+        zz += other.zz; zw += other.zw;
+        ww += other.ww;
+        weight += other.weight;
+    }
+
+    // Area-weighted squared distance from the point to the planes
+    double evaluate(const glm::vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return xx * x * x + 2 * xy * x * y + 2 * xz * x * z + 2 * xw * x
+             + yy * y * y + 2 * yz * y * z + 2 * yw * y
+             + zz * z * z + 2 * zw * z
+             + ww;
+    }
+};
+
+struct EdgeCollapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+// Simplify toward targetIndexCount indices. Vertices on open edges stay put,
+// which also holds UV and normal seams together since seams are split in the
+// index buffer. error receives the largest collapse error as a distance in
+// model units.
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float& error) {
+    const size_t vertexCount = vertices.size();
+    std::vector<uint32_t> current = indices;
+    error = 0.0f;
+
+    // Plane quadric of every triangle, summed into its corners
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t < current.size(); t += 3) {
+        glm::vec3 a = vertices[current[t]].position;
+        glm::vec3 normal = glm::cross(vertices[current[t + 1]].position - a, vertices[current[t + 2]].position - a);
+        float length = glm::length(normal);
+        if (length <= 0.0f) continue;
+        normal /= length;
+        double d = -glm::dot(normal, a);
+        for (int k = 0; k < 3; k++) quadrics[current[t + k]].addPlane(normal.x, normal.y, normal.z, d, length * 0.5);
+    }
+
+    // Vertices on edges used by a single triangle are locked
+    std::vector<bool> locked(vertexCount, false);
+    {
+        std::vector<std::pair<uint64_t, int>> edges;
+        edges.reserve(current.size());
+        for (size_t t = 0; t < current.size(); t += 3) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = current[t + k], b = current[t + (k + 1) % 3];
+                edges.push_back({ (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b), 1 });
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size();) {
+            size_t j = i;
+            while (j < edges.size() && edges[j].first == edges[i].first) j++;
+            if (j - i == 1) {
+                locked[edges[i].first >> 32] = true;
+                locked[edges[i].first & 0xFFFFFFFFu] = true;
+            }
+            i = j;
+        }
+    }
+
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<EdgeCollapse> collapses;
+    double maxCost = 0.0;
+
+    // Each pass collapses a batch of the cheapest independent edges, then rebuilds the index list
+    while (current.size() > targetIndexCount) {
+        // Vertex to triangle adjacency of the current triangles
+        std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+        for (uint32_t index : current) adjacencyOffset[index + 1]++;
+        for (size_t v = 0; v < vertexCount; v++) adjacencyOffset[v + 1] += adjacencyOffset[v];
+        adjacency.resize(current.size());
+        std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (size_t i = 0; i < current.size(); i++) adjacency[fill[current[i]]++] = static_cast<uint32_t>(i / 3);
+
+        // Cheapest direction of every edge
+        collapses.clear();
+        for (size_t t = 0; t < current.size(); t += 3) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = current[t + k], b = current[t + (k + 1) % 3];
+                if (a > b) continue; // Interior edges are seen from both sides, take one
+                Quadric combined = quadrics[a];
+                combined.add(quadrics[b]);
+                double toB = locked[a] ? INFINITY : combined.evaluate(vertices[b].position);
+                double toA = locked[b] ? INFINITY : combined.evaluate(vertices[a].position);
+                if (std::isinf(toA) && std::isinf(toB)) continue;
+                if (toB <= toA) {
+                    collapses.push_back({ a, b, toB });
+                } else {
+                    collapses.push_back({ b, a, toA });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse& x, const EdgeCollapse& y) { return x.cost < y.cost; });
+
+        for (size_t v = 0; v < vertexCount; v++) remap[v] = static_cast<uint32_t>(v);
+        std::fill(touched.begin(), touched.end(), false);
+        size_t trianglesToRemove = (current.size() - targetIndexCount) / 3;
+        size_t removed = 0;
+
+        for (const EdgeCollapse& collapse : collapses) {
+            if (removed >= trianglesToRemove) break;
+            if (touched[collapse.from] || touched[collapse.to]) continue;
+
+            // Reject collapses that would flip a triangle around the moving vertex
+            const glm::vec3& target = vertices[collapse.to].position;
+            bool flips = false;
+            size_t sharedTriangles = 0;
+            for (uint32_t a = adjacencyOffset[collapse.from]; a < adjacencyOffset[collapse.from + 1] && !flips; a++) {
+                const uint32_t* triangle = &current[adjacency[a] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    sharedTriangles++;
+                    continue; // Becomes degenerate and is dropped
+                }
+                glm::vec3 corners[3], moved[3];
+                for (int k = 0; k < 3; k++) {
+                    corners[k] = vertices[triangle[k]].position;
+                    moved[k] = triangle[k] == collapse.from ? target : corners[k];
+                }
+                glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                flips = glm::dot(before, after) <= 0.0f;
+            }
+            if (flips) continue;
+
+            // Freeze the neighborhood for the rest of the pass so the checks above stay valid
+            for (uint32_t a = adjacencyOffset[collapse.from]; a < adjacencyOffset[collapse.from + 1]; a++) {
+                const uint32_t* triangle = &current[adjacency[a] * 3];
+                for (int k = 0; k < 3; k++) touched[triangle[k]] = true;
+            }
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            maxCost = std::max(maxCost, collapse.cost / std::max(quadrics[collapse.to].weight, 1e-12));
+            removed += sharedTriangles;
+        }
+        if (removed == 0) break; // Nothing left that can collapse
+
+        // Apply the collapses and drop the triangles that became degenerate
+        size_t write = 0;
+        for (size_t t = 0; t < current.size(); t += 3) {
+            uint32_t a = remap[current[t]], b = remap[current[t + 1]], c = remap[current[t + 2]];
+            if (a == b || b == c || a == c) continue;
+            current[write++] = a;
+            current[write++] = b;
+            current[write++] = c;
+        }
+        current.resize(write);
+    }
+
+    error = static_cast<float>(std::sqrt(maxCost));
+    return current;
+}
+
+// Build up to MAX_MESH_LODS levels, each with half the triangles of the one
+// before. The extra levels are appended to indices and reordered for the
+// vertex cache; a level that barely shrinks ends the chain.
+void buildMeshLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods) {
+    lods.clear();
+    lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+    std::vector<uint32_t> source = indices;
+    float accumulatedError = 0.0f;
+    for (int level = 1; level < MAX_MESH_LODS; level++) {
+        size_t target = (source.size() / 2) / 3 * 3;
+        if (target < 3) break;
+
+        float levelError;
+        std::vector<uint32_t> simplified = simplifyMesh(vertices, source, target, levelError);
+        if (simplified.empty() || simplified.size() > source.size() * 3 / 4) break;
+
+        std::vector<size_t> clusterStarts;
+        simplified = optimizeVertexCache(simplified, vertices.size(), clusterStarts);
+
+        // Each level starts from the previous one, so the errors add up
+        accumulatedError += levelError;
+        lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), accumulatedError });
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        source = std::move(simplified);
+    }
+}
+
+// Build LODs when importing models, they are stored in the mesh cache
+bool generateMeshLods = true;
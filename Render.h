@@ -3,87 +3,382 @@
 //deltaTime
 float currentDeltaTime;
 
-// Tween parameters
-struct Tween {
-    glm::vec3 startRotation; // Starting rotation (in degrees)
-    glm::vec3 endRotation;   // Target rotation (in degrees)
-    float duration;          // Duration of the tween in seconds
-    float elapsedTime;       // Time elapsed since the tween started
-    float speed; // Speed of the tween
+// Uniform buffer holding the view and projection matrices (std140)
+GLuint matricesUBO = 0;
+
+void createMatricesBuffer() {
+    glGenBuffers(1, &matricesUBO);
+    glState.bindBuffer(GL_UNIFORM_BUFFER, matricesUBO);
+    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+    glState.bindBufferBase(GL_UNIFORM_BUFFER, MATRICES_BINDING, matricesUBO);
+}
+
+// Upload the camera matrices once per frame, every program reads them through the block
+void uploadFrameMatrices(const glm::mat4& view, const glm::mat4& projection) {
+    glState.bindBuffer(GL_UNIFORM_BUFFER, matricesUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(view));
+    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(projection));
+}
+
+// Instance buffer shared by every batch, refilled once per frame
+GLuint instanceVBO = 0;
+std::vector<InstanceData> instanceData;
+std::vector<SortEntry> batchOrder; // (mesh id << 34 | lod << 32 | texture, dense index)
+std::vector<float> viewDistances; // Indexed like the scene store, filled for visible models
+
+// One submesh of one batch, the render queue orders these by their sort keys
+struct RenderItem {
+    const Submesh* submesh;
+    GLuint texture;
+    GLuint VAO;
+    uint32_t lod;
+    uint32_t firstInstance; // Into instanceData
+    uint32_t instanceCount;
+};
+
+std::vector<RenderItem> renderItems;
+std::vector<SortEntry> renderOrder; // (sort key, render item)
+std::vector<SortEntry> sortScratch;
+
+void createInstanceBuffer() {
+    glGenBuffers(1, &instanceVBO);
+}
+
+void destroyInstanceBuffer() {
+    glState.deleteBuffer(instanceVBO);
+}
+
+// Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
 };
 
-// Map to hold tween data for models
-std::map<int, Tween> needToTween;
-std::map<int, Tween> needToTween_POS;
+// Submit the scene with glMultiDrawElementsIndirect when the driver offers it
+// with base instances; the 3.3 core context otherwise draws batch by batch
+bool useMultiDrawIndirect = true;
+GLuint indirectBuffer = 0;
+std::vector<DrawElementsIndirectCommand> drawCommands;
+std::vector<InstanceData> drawInstances;
+
+bool multiDrawIndirectSupported() {
+    return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+// Base instances offset the instanced attributes, so they are pointed once per VAO
+bool baseInstanceSupported() {
+    return GLEW_VERSION_4_2 || GLEW_ARB_base_instance;
+}
+
+void createIndirectBuffer() {
+    glGenBuffers(1, &indirectBuffer);
+}
+
+void destroyIndirectBuffer() {
+    glState.deleteBuffer(indirectBuffer);
+}
+
+// Walk the scene BVH when culling, otherwise test every model's sphere
+bool useBvhCulling = true;
+
+// Switch to LOD i + 1 once a model's bounding sphere covers less than
+// lodScreenSizes[i] of the screen height. The hysteresis band keeps models
+// sitting on a threshold from flickering between two levels.
+float lodScreenSizes[MAX_MESH_LODS - 1] = { 0.5f, 0.25f, 0.1f };
+float lodHysteresis = 0.1f;
 
-float LinearEase(float t) {
-    return t; // Linear interpolation
+// Pick the level for a sphere, starting from the one drawn last frame
+uint8_t selectLod(const Mesh& mesh, uint8_t currentLod, float screenSize) {
+    int lod = std::min<int>(currentLod, static_cast<int>(mesh.lodCount) - 1);
+    while (lod > 0 && screenSize > lodScreenSizes[lod - 1] * (1.0f + lodHysteresis)) lod--;
+    while (lod + 1 < static_cast<int>(mesh.lodCount) && screenSize < lodScreenSizes[lod] * (1.0f - lodHysteresis)) lod++;
+    return static_cast<uint8_t>(lod);
 }
 
-float EaseIn(float t) {
-    return t * t; // Accelerating from zero velocity
+// Per-frame counters
+struct RenderStats {
+    size_t visible = 0;
+    size_t culled = 0;
+    size_t drawCalls = 0;
+    size_t triangles = 0;
+    size_t stateChanges = 0;        // Binds and uniform sets issued by the render queue
+    size_t stateChangesAvoided = 0; // Skipped because the value was already set
+    size_t transformsUpdated = 0;   // World matrices recomputed because the model moved
+};
+
+RenderStats renderStats;
+
+// World bounding spheres, indexed like the scene store
+std::vector<float> sphereX, sphereY, sphereZ, sphereRadius;
+std::vector<uint32_t> visibleModels;
+
+// Move a model's mesh bounding sphere into world space with its cached matrix
+void updateWorldSphere(size_t i) {
+    // Models still loading get an infinitely negative radius, which fails every plane test
+    if (sceneStore.meshIds[i] == INVALID_MESH) {
+        sphereX[i] = sphereY[i] = sphereZ[i] = 0.0f;
+        sphereRadius[i] = -std::numeric_limits<float>::infinity();
+        return;
+    }
+    const Mesh& mesh = meshes[sceneStore.meshIds[i]];
+    const glm::mat4& modelMatrix = sceneStore.worldMatrices[i];
+
+    glm::vec4 center = modelMatrix * glm::vec4(mesh.bounds.sphereCenter, 1.0f);
+    float maxScale = std::max(glm::length(glm::vec3(modelMatrix[0])), std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    sphereX[i] = center.x;
+    sphereY[i] = center.y;
+    sphereZ[i] = center.z;
+    sphereRadius[i] = mesh.bounds.sphereRadius * maxScale;
 }
 
-float EaseOut(float t) {
-    return t * (2 - t); // Decelerating to zero velocity
+// Rebuild the world matrix, culling sphere and BVH leaf of each model marked
+// dirty since the last call. Models that did not move cost nothing.
+void updateDirtyTransforms() {
+    const size_t count = sceneStore.size();
+    sphereX.resize(count);
+    sphereY.resize(count);
+    sphereZ.resize(count);
+    sphereRadius.resize(count);
+
+    for (ModelHandle handle : sceneStore.dirtyModels) {
+        int index = sceneStore.indexOf(handle);
+        if (index < 0) continue; // Removed after it was marked
+        sceneStore.transformDirty[index] = 0;
+        sceneStore.worldMatrices[index] = computeModelMatrix(sceneStore.positions[index], sceneStore.rotations[index], sceneStore.scales[index]);
+        updateWorldSphere(index);
+        updateModelBounds(index);
+        renderStats.transformsUpdated++;
+    }
+    sceneStore.dirtyModels.clear();
 }
 
-float EaseInOut(float t) {
-    return t < 0.5 ? 2 * t * t : -1 + (4 - 2 * t) * t; // Acceleration until halfway, then deceleration
+// Uniforms and instance pointers the queue last set; binds are filtered by glState
+struct SubmitState {
+    int useTexture = -1;
+    int useMaterialColor = -1;
+    glm::vec3 materialColor = glm::vec3(-1.0f);
+    uint32_t firstInstance = UINT32_MAX;
+};
+
+// Count a state change, or one skipped because the value is already set
+bool changeState(bool different) {
+    if (different) {
+        renderStats.stateChanges++;
+    } else {
+        renderStats.stateChangesAvoided++;
+    }
+    return different;
 }
 
-glm::vec3 DoTweenFunc(const glm::vec3& start, const glm::vec3& end, float duration, float (*easeFunc)(float)) {
-    float t = currentDeltaTime / duration; // Calculate the progress
-    t = glm::clamp(t, 0.0f, 1.0f); // Clamp to [0, 1]
-    
-    // Apply the easing function
-    float easedT = easeFunc(t);
-    
-    // Interpolate
-    return start + (end - start) * easedT; 
+// Turn every batch into one item per submesh and sort the items by program,
+// texture, vertex arena and the distance of the batch's nearest model
+void buildRenderQueue(const ShaderProgram& shaderProgram) {
+    const size_t count = batchOrder.size();
+    renderItems.clear();
+    renderOrder.clear();
+
+    size_t first = 0;
+    while (first < count) {
+        uint64_t key = batchOrder[first].first;
+        size_t last = first;
+        float nearest = std::numeric_limits<float>::max();
+        while (last < count && batchOrder[last].first == key) {
+            nearest = std::min(nearest, viewDistances[batchOrder[last].second]);
+            last++;
+        }
+
+        const Mesh& mesh = meshes[key >> 34];
+        uint32_t level = (key >> 32) & 3;
+        GLuint modelTexture = static_cast<GLuint>(key & 0xFFFFFFFFu); // Covers submeshes without their own
+        GLuint VAO = geometryArena(mesh.quantized).VAO;
+
+        for (const Submesh& submesh : mesh.submeshes) {
+            RenderItem item;
+            item.submesh = &submesh;
+            item.texture = submesh.textureID != 0 ? submesh.textureID : modelTexture;
+            item.VAO = VAO;
+            item.lod = std::min(level, submesh.lodCount - 1);
+            item.firstInstance = static_cast<uint32_t>(first);
+            item.instanceCount = static_cast<uint32_t>(last - first);
+            renderOrder.push_back({ makeSortKey(shaderProgram.id, item.texture, mesh.quantized ? 1 : 0, nearest), static_cast<uint32_t>(renderItems.size()) });
+            renderItems.push_back(item);
+        }
+        first = last;
+    }
+    radixSort(renderOrder, sortScratch);
 }
 
-// Function to render all loaded models
-void renderModels(GLuint shaderProgram) {
-    for (const auto& model : models) {
-        GLuint VAO = std::get<0>(model);
-        unsigned int indexCount = std::get<1>(model).first;
-        glm::vec3 position = std::get<1>(model).second;
-        glm::vec3 color = std::get<0>(std::get<2>(model));
-        glm::vec3 scale = std::get<1>(std::get<2>(model));
-        glm::vec3 rotationAxis = std::get<2>(std::get<2>(model));
-        GLuint textureID = std::get<3>(model); // Get textureID
-
-        // Normalize the axis and calculate the angle
-        float rotationAngle = glm::length(rotationAxis);
-        if (rotationAngle > 0.0f) {
-            rotationAxis = glm::normalize(rotationAxis);
+// Draw the queue from the CPU, one instanced draw per item, setting only the state that changed
+void drawRenderQueue(const ShaderProgram& shaderProgram) {
+    // Upload every instance at once, orphaning last frame's storage
+    glState.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(InstanceData), instanceData.data(), GL_STREAM_DRAW);
+
+    const bool baseInstance = baseInstanceSupported();
+    SubmitState state;
+    for (const SortEntry& entry : renderOrder) {
+        const RenderItem& item = renderItems[entry.second];
+        const Submesh& submesh = *item.submesh;
+        const MeshLod& lod = submesh.lods[item.lod];
+
+        if (changeState(glState.bindVertexArray(item.VAO))) {
+            state.firstInstance = UINT32_MAX; // Instance pointers are VAO state
         }
 
-        glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), position);
-        modelMatrix = glm::rotate(modelMatrix, rotationAngle, rotationAxis); // Rotation
-        modelMatrix = glm::scale(modelMatrix, scale); // Scaling
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(modelMatrix));
+        // With base instances the pointers stay at 0 and the draw offsets them
+        uint32_t firstInstance = baseInstance ? 0 : item.firstInstance;
+        if (changeState(state.firstInstance != firstInstance)) {
+            pointInstanceAttributes(firstInstance);
+            state.firstInstance = firstInstance;
+        }
 
         // Check if the texture is used
-        glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), textureID != 0); // Set the useTexture uniform
+        if (changeState(state.useTexture != (item.texture != 0))) {
+            glUniform1i(shaderProgram.useTexture, item.texture != 0);
+            state.useTexture = item.texture != 0;
+        }
+        if (item.texture != 0) {
+            changeState(glState.bindTexture(0, item.texture));
+        }
+
+        if (changeState(state.useMaterialColor != submesh.hasMaterial)) {
+            glUniform1i(shaderProgram.useMaterialColor, submesh.hasMaterial);
+            state.useMaterialColor = submesh.hasMaterial;
+        }
+        if (submesh.hasMaterial && changeState(state.materialColor != submesh.materialColor)) {
+            glUniform3fv(shaderProgram.materialColor, 1, glm::value_ptr(submesh.materialColor));
+            state.materialColor = submesh.materialColor;
+        }
+
+        // Indices are relative to the submesh, baseVertex moves them into the arena
+        const GLvoid* indices = (GLvoid*)(lod.firstIndex * sizeof(GLuint));
+        if (baseInstance) {
+            glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, lod.indexCount, GL_UNSIGNED_INT, indices, item.instanceCount, submesh.baseVertex, item.firstInstance);
+        } else {
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lod.indexCount, GL_UNSIGNED_INT, indices, item.instanceCount, submesh.baseVertex);
+        }
+        renderStats.drawCalls++;
+        renderStats.triangles += lod.indexCount / 3 * item.instanceCount;
+    }
+}
+
+// Submit each run of queue items sharing a texture and vertex arena with a single
+// glMultiDrawElementsIndirect. Every command gets its own copy of its batch's
+// instances, found through baseInstance, with the material color folded in.
+void drawRenderQueueIndirect(const ShaderProgram& shaderProgram) {
+    drawCommands.resize(renderOrder.size());
+    drawInstances.clear();
+    for (size_t i = 0; i < renderOrder.size(); i++) {
+        const RenderItem& item = renderItems[renderOrder[i].second];
+        const Submesh& submesh = *item.submesh;
+        const MeshLod& lod = submesh.lods[item.lod];
+        drawCommands[i] = { lod.indexCount, item.instanceCount, lod.firstIndex, static_cast<GLint>(submesh.baseVertex), static_cast<GLuint>(drawInstances.size()) };
+        for (uint32_t k = 0; k < item.instanceCount; k++) {
+            InstanceData instance = instanceData[item.firstInstance + k];
+            if (submesh.hasMaterial) instance.color = glm::vec4(submesh.materialColor, 1.0f);
+            drawInstances.push_back(instance);
+        }
+        renderStats.triangles += lod.indexCount / 3 * item.instanceCount;
+    }
+
+    // Upload the instances and commands at once, orphaning last frame's storage
+    glState.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, drawInstances.size() * sizeof(InstanceData), drawInstances.data(), GL_STREAM_DRAW);
+    glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, drawCommands.size() * sizeof(DrawElementsIndirectCommand), drawCommands.data(), GL_STREAM_DRAW);
+
+    // The instance color already holds the material color
+    glUniform1i(shaderProgram.useMaterialColor, GL_FALSE);
 
-        // Set color for the fragment shader
-        glUniform3fv(glGetUniformLocation(shaderProgram, "color"), 1, glm::value_ptr(color));
+    SubmitState state;
+    size_t start = 0;
+    while (start < renderOrder.size()) {
+        const RenderItem& item = renderItems[renderOrder[start].second];
+        size_t end = start + 1;
+        while (end < renderOrder.size() && renderItems[renderOrder[end].second].texture == item.texture && renderItems[renderOrder[end].second].VAO == item.VAO) end++;
 
-        // Bind the texture if textureID is not zero
-        if (textureID != 0) {
-            glActiveTexture(GL_TEXTURE0); // Activate texture unit
-            glBindTexture(GL_TEXTURE_2D, textureID); // Bind texture
+        // baseInstance offsets the instanced attributes, so they always start at instance 0
+        if (changeState(glState.bindVertexArray(item.VAO)) || state.firstInstance != 0) {
+            pointInstanceAttributes(0);
+            state.firstInstance = 0;
+        }
+        if (changeState(state.useTexture != (item.texture != 0))) {
+            glUniform1i(shaderProgram.useTexture, item.texture != 0);
+            state.useTexture = item.texture != 0;
+        }
+        if (item.texture != 0) {
+            changeState(glState.bindTexture(0, item.texture));
         }
 
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (GLvoid*)(start * sizeof(DrawElementsIndirectCommand)), static_cast<GLsizei>(end - start), 0);
+        renderStats.drawCalls++;
+        start = end;
+    }
+}
+
+// Function to render all loaded models, grouped into batches of the same mesh, LOD and texture.
+// projectionScale is projection[1][1], it turns view distance into screen size.
+// renderStats is reset by the caller at frame start, so transforms rebuilt
+// earlier in the frame (picking) are counted too.
+void renderModels(const ShaderProgram& shaderProgram, const Frustum& frustum, const glm::vec3& cameraPosition, float projectionScale) {
+    updateDirtyTransforms();
+    const size_t total = sceneStore.size();
+    if (total == 0) return;
+
+    // Cull everything outside the camera's view before building batches
+    visibleModels.clear();
+    if (useBvhCulling) {
+        sceneBvh.cullFrustum(frustum, visibleModels);
 
-        // Unbind the texture
-        if (textureID != 0) {
-            glBindTexture(GL_TEXTURE_2D, 0);
+        // Leaves hold slot indices
+        for (uint32_t& index : visibleModels) {
+            index = sceneStore.slotToDense[index];
         }
+    } else {
+        cullSpheres(frustum, sphereX.data(), sphereY.data(), sphereZ.data(), sphereRadius.data(), total, visibleModels);
+    }
+
+    const size_t count = visibleModels.size();
+    renderStats.visible = count;
+    renderStats.culled = total - count;
+    if (count == 0) return;
+
+    // Choose each model's LOD from the screen height its bounding sphere covers
+    viewDistances.resize(total);
+    for (uint32_t index : visibleModels) {
+        const Mesh& mesh = meshes[sceneStore.meshIds[index]];
+        const glm::mat4& modelMatrix = sceneStore.worldMatrices[index];
+        glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(mesh.bounds.sphereCenter, 1.0f));
+        float maxScale = std::max(glm::length(glm::vec3(modelMatrix[0])), std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        float distance = viewDistances[index] = std::max(glm::length(center - cameraPosition), 1e-4f);
+        float screenSize = mesh.bounds.sphereRadius * maxScale * projectionScale / distance;
+        sceneStore.lodLevels[index] = selectLod(mesh, sceneStore.lodLevels[index], screenSize);
+    }
+
+    // Sort models so the ones sharing a mesh, LOD and texture sit next to each other
+    batchOrder.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t index = visibleModels[i];
+        uint64_t key = (static_cast<uint64_t>(sceneStore.meshIds[index]) << 34) | (static_cast<uint64_t>(sceneStore.lodLevels[index]) << 32) | sceneStore.textures[index];
+        batchOrder[i] = { key, index };
+    }
+    radixSort(batchOrder, sortScratch);
+
+    // Gather the per-instance data in batch order, folding in each mesh's dequantization
+    instanceData.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t index = batchOrder[i].second;
+        instanceData[i].model = sceneStore.worldMatrices[index] * meshes[sceneStore.meshIds[index]].dequantize;
+        instanceData[i].color = glm::vec4(sceneStore.colors[index], 1.0f);
+    }
+
+    buildRenderQueue(shaderProgram);
+    if (useMultiDrawIndirect && multiDrawIndirectSupported()) {
+        drawRenderQueueIndirect(shaderProgram);
+    } else {
+        drawRenderQueue(shaderProgram);
     }
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+// Sort keys for the per-frame draw list. Draws are ordered by the state they
+// need, most expensive to change first, so neighbors share as much as possible:
+//   63-56 program | 55-32 texture | 31-28 vertex arena | 27-0 view depth
+// Within a state group the depth bits draw the nearest objects first, which
+// lets early depth testing reject what they hide.
+
+// (key, payload) pair, the payload is whatever index the caller sorts
+using SortEntry = std::pair<uint64_t, uint32_t>;
+
+// Positive floats order like their bit patterns, keep the top 28 bits
+uint64_t depthSortBits(float depth) {
+    if (!(depth > 0.0f)) return 0;
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return bits >> 3; // Sign bit is zero, 31 bits left
+}
+
+uint64_t makeSortKey(uint32_t program, uint32_t texture, uint32_t arena, float depth) {
+    return (static_cast<uint64_t>(program & 0xFFu) << 56)
+         | (static_cast<uint64_t>(texture & 0xFFFFFFu) << 32)
+         | (static_cast<uint64_t>(arena & 0xFu) << 28)
+         | (depthSortBits(depth) & 0xFFFFFFFu);
+}
+
+// Stable LSD radix sort on 8-bit digits. All eight histograms come from one
+// pass over the keys, and digits where every key agrees are skipped, so keys
+// that only use a few bytes cost a few passes.
+void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+    const size_t count = entries.size();
+    if (count < 2) return;
+
+    uint32_t histograms[8][256];
+    std::memset(histograms, 0, sizeof(histograms));
+    for (const SortEntry& entry : entries) {
+        for (int digit = 0; digit < 8; digit++) {
+            histograms[digit][(entry.first >> (digit * 8)) & 0xFF]++;
+        }
+    }
+
+    scratch.resize(count);
+    for (int digit = 0; digit < 8; digit++) {
+        uint32_t* histogram = histograms[digit];
+        if (histogram[(entries[0].first >> (digit * 8)) & 0xFF] == count) continue;
+
+        uint32_t offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++) {
+            uint32_t size = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += size;
+        }
+        for (const SortEntry& entry : entries) {
+            scratch[histogram[(entry.first >> (digit * 8)) & 0xFF]++] = entry;
+        }
+        entries.swap(scratch);
+    }
+}
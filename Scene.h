@@ -0,0 +1,195 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "Mesh.h"
+#include "Bvh.h"
+
+// Stable reference to a model. Slots are reused after removal, so the
+// generation tells a live model apart from an older one that used the slot.
+struct ModelHandle {
+    uint32_t index = 0;
+    uint32_t generation = 0; // 0 is never handed out, so a default handle is invalid
+
+    bool operator==(const ModelHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const ModelHandle& other) const { return !(*this == other); }
+    bool operator<(const ModelHandle& other) const {
+        return index != other.index ? index < other.index : generation < other.generation;
+    }
+};
+
+// The public API takes rotations as an axis scaled by the angle in radians
+glm::quat axisAngleRotation(const glm::vec3& rotationAxis) {
+    float rotationAngle = glm::length(rotationAxis);
+    if (rotationAngle <= 0.0f) return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    return glm::angleAxis(rotationAngle, rotationAxis / rotationAngle);
+}
+
+// Structure-of-arrays storage for every model in the scene.
+// Each model lives at the same dense index in every array, so passes that only
+// touch transforms never pull colors or mesh ids through the cache.
+// Handles go through a slot map, which keeps lookups and removals O(1).
+struct SceneStore {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::vec3> colors;
+    std::vector<uint32_t> meshIds; // Index into the mesh registry
+    std::vector<GLuint> textures;
+    std::vector<int32_t> bvhProxies; // Leaf in sceneBvh, BVH_NULL until the bounds are known
+    std::vector<uint8_t> lodLevels; // Level drawn last frame, kept for hysteresis
+
+    // World matrix cache. Changing a transform only marks the model dirty,
+    // updateDirtyTransforms recomputes the ones in dirtyModels once a frame.
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<uint8_t> transformDirty;
+    std::vector<ModelHandle> dirtyModels;
+
+    // Slot map
+    std::vector<uint32_t> slotToDense;
+    std::vector<uint32_t> slotGenerations;
+    std::vector<uint32_t> denseToSlot;
+    std::vector<uint32_t> freeSlots;
+
+    size_t size() const { return positions.size(); }
+
+    bool isValid(ModelHandle handle) const {
+        return handle.generation != 0 && handle.index < slotGenerations.size() && slotGenerations[handle.index] == handle.generation;
+    }
+
+    // Dense index of a live model, or -1
+    int indexOf(ModelHandle handle) const {
+        return isValid(handle) ? static_cast<int>(slotToDense[handle.index]) : -1;
+    }
+
+    // Handle of the model stored at a dense index
+    ModelHandle handleAt(size_t denseIndex) const {
+        uint32_t slot = denseToSlot[denseIndex];
+        return { slot, slotGenerations[slot] };
+    }
+
+    // Append a model and return its handle, rotation is an axis scaled by the angle
+    ModelHandle add(uint32_t meshId, glm::vec3 position, glm::vec3 color, glm::vec3 scale, glm::vec3 rotation, GLuint texture) {
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            slot = static_cast<uint32_t>(slotGenerations.size());
+            slotToDense.push_back(0);
+            slotGenerations.push_back(1);
+        }
+        slotToDense[slot] = static_cast<uint32_t>(size());
+        denseToSlot.push_back(slot);
+
+        positions.push_back(position);
+        rotations.push_back(axisAngleRotation(rotation));
+        scales.push_back(scale);
+        colors.push_back(color);
+        meshIds.push_back(meshId);
+        textures.push_back(texture);
+        bvhProxies.push_back(BVH_NULL);
+        lodLevels.push_back(0);
+        worldMatrices.push_back(glm::mat4(1.0f));
+        transformDirty.push_back(0);
+        markTransformDirty(slotToDense[slot]);
+        return { slot, slotGenerations[slot] };
+    }
+
+    // Swap the last model into the removed one's place and retire its slot
+    void remove(ModelHandle handle) {
+        if (!isValid(handle)) return;
+        uint32_t index = slotToDense[handle.index];
+        uint32_t last = static_cast<uint32_t>(size()) - 1;
+        if (index != last) {
+            positions[index] = positions[last];
+            rotations[index] = rotations[last];
+            scales[index] = scales[last];
+            colors[index] = colors[last];
+            meshIds[index] = meshIds[last];
+            textures[index] = textures[last];
+            bvhProxies[index] = bvhProxies[last];
+            lodLevels[index] = lodLevels[last];
+            worldMatrices[index] = worldMatrices[last];
+            transformDirty[index] = transformDirty[last];
+            denseToSlot[index] = denseToSlot[last];
+            slotToDense[denseToSlot[index]] = index;
+        }
+        positions.pop_back();
+        rotations.pop_back();
+        scales.pop_back();
+        colors.pop_back();
+        meshIds.pop_back();
+        textures.pop_back();
+        bvhProxies.pop_back();
+        lodLevels.pop_back();
+        worldMatrices.pop_back();
+        transformDirty.pop_back();
+        denseToSlot.pop_back();
+
+        // Skip generation 0 on wrap-around so it stays invalid
+        if (++slotGenerations[handle.index] == 0) slotGenerations[handle.index] = 1;
+        freeSlots.push_back(handle.index);
+
+        // Per-index data kept outside the store (the culling spheres) now
+        // belongs to another model, refresh it with the next update
+        if (index != last) markTransformDirty(index);
+    }
+
+    // Queue a model whose position, rotation, scale or mesh changed
+    void markTransformDirty(uint32_t index) {
+        if (transformDirty[index]) return;
+        transformDirty[index] = 1;
+        dirtyModels.push_back(handleAt(index));
+    }
+
+    // Accessors, the handle must be valid
+    glm::vec3& position(ModelHandle handle) { return positions[slotToDense[handle.index]]; }
+    glm::quat& rotation(ModelHandle handle) { return rotations[slotToDense[handle.index]]; }
+    glm::vec3& scale(ModelHandle handle) { return scales[slotToDense[handle.index]]; }
+    glm::vec3& color(ModelHandle handle) { return colors[slotToDense[handle.index]]; }
+    uint32_t meshId(ModelHandle handle) const { return meshIds[slotToDense[handle.index]]; }
+    GLuint texture(ModelHandle handle) const { return textures[slotToDense[handle.index]]; }
+};
+
+SceneStore sceneStore;
+
+// Hierarchy over the world bounds of every model, leaves carry the model's slot index
+DynamicBvh sceneBvh;
+
+// translate * rotate * scale written out: the quaternion turns into the
+// rotation columns with a few multiplies, no trigonometry
+glm::mat4 computeModelMatrix(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+    glm::mat3 basis = glm::mat3_cast(rotation);
+    return glm::mat4(
+        glm::vec4(basis[0] * scale.x, 0.0f),
+        glm::vec4(basis[1] * scale.y, 0.0f),
+        glm::vec4(basis[2] * scale.z, 0.0f),
+        glm::vec4(position, 1.0f));
+}
+
+// Recompute a model's world bounds from its cached world matrix and insert or
+// refit its BVH leaf. Called for every dirty model once its matrix is current.
+void updateModelBounds(int index) {
+    if (sceneStore.meshIds[index] == INVALID_MESH) return; // Still loading, inserted once the mesh arrives
+    const Mesh& mesh = meshes[sceneStore.meshIds[index]];
+    AABB bounds = transformBounds(sceneStore.worldMatrices[index], mesh.bounds.boundsMin, mesh.bounds.boundsMax);
+
+    int32_t& proxy = sceneStore.bvhProxies[index];
+    if (proxy == BVH_NULL) {
+        proxy = sceneBvh.insert(bounds, sceneStore.denseToSlot[index]);
+    } else {
+        sceneBvh.move(proxy, bounds);
+    }
+}
+
+void removeModelBounds(int index) {
+    int32_t& proxy = sceneStore.bvhProxies[index];
+    if (proxy != BVH_NULL) {
+        sceneBvh.remove(proxy);
+        proxy = BVH_NULL;
+    }
+}
@@ -0,0 +1,298 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <filesystem>
+#include <cstdint>
+#include <utility>
+#include <GL/glew.h>
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include "stb_image.h"
+#endif
+#include "MappedFile.h"
+#include "TextureContainer.h"
+#include "GLStateCache.h"
+#include "Log.h"
+
+// Decoded image pixels, freed with stb_image once they are no longer needed
+struct ImageData {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    unsigned char* pixels = nullptr;
+
+    ImageData() = default;
+    ImageData(const ImageData&) = delete;
+    ImageData& operator=(const ImageData&) = delete;
+    ImageData(ImageData&& other) noexcept { *this = std::move(other); }
+    ImageData& operator=(ImageData&& other) noexcept {
+        std::swap(width, other.width);
+        std::swap(height, other.height);
+        std::swap(channels, other.channels);
+        std::swap(pixels, other.pixels);
+        return *this;
+    }
+    ~ImageData() {
+        if (pixels) stbi_image_free(pixels);
+    }
+};
+
+// Decode an image file, safe to call from worker threads
+bool decodeImage(const std::string& path, ImageData& image) {
+    // The flip flag is per thread so concurrent decodes do not race on it
+    stbi_set_flip_vertically_on_load_thread(true); // Flip loaded texture coordinates
+    image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+    if (!image.pixels) {
+        LOG_ERROR << "ERROR::IMAGE-LOADING Failed to load texture: " << path;
+        return false;
+    }
+    return true;
+}
+
+// Create a GL texture from decoded pixels, must run on the GL thread
+GLuint uploadTexture(const ImageData& image) {
+    if (!image.pixels) return 0;
+
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+
+    GLenum format = (image.channels == 1) ? GL_RED : (image.channels == 3) ? GL_RGB : GL_RGBA;
+    glState.bindTexture(0, textureID);
+
+    // Generate texture
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    // Set texture parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return textureID;
+}
+
+// Compressed containers need S3TC from the driver, plain RGBA8 always works
+bool textureFormatSupported(uint32_t format) {
+    if (format == TEXTURE_FORMAT_RGBA8) return true;
+    return GLEW_EXT_texture_compression_s3tc;
+}
+
+// A texture with its mip chain precomputed by texturetool, mapped from disk
+struct TextureContainer {
+    MappedFile file;
+    TextureContainerHeader header;
+    const TextureContainerLevel* levels = nullptr;
+};
+
+GLenum containerInternalFormat(uint32_t format) {
+    return (format == TEXTURE_FORMAT_BC1) ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+         : (format == TEXTURE_FORMAT_BC3) ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+         : GL_RGBA8;
+}
+
+// Create a texture with storage for every level of a container, the pixels
+// are uploaded separately. Leaves the texture bound, must run on the GL thread.
+GLuint allocateContainerTexture(const TextureContainer& container) {
+    const TextureContainerHeader& header = container.header;
+    GLenum internalFormat = containerInternalFormat(header.format);
+
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glState.bindTexture(0, textureID);
+    for (uint32_t i = 0; i < header.mipCount; i++) {
+        const TextureContainerLevel& level = container.levels[i];
+        if (header.format == TEXTURE_FORMAT_RGBA8) {
+            glTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        } else {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.width, level.height, 0, static_cast<GLsizei>(level.size), nullptr);
+        }
+    }
+
+    // The stored levels are the whole chain, no glGenerateMipmap
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.mipCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, header.mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return textureID;
+}
+
+// Create a GL texture from every level of a container in one go, must run on
+// the GL thread. The frame loop streams containers through TextureStreamer
+// instead, this is for loads that block anyway.
+GLuint uploadTextureContainer(const TextureContainer& container) {
+    const TextureContainerHeader& header = container.header;
+    GLuint textureID = allocateContainerTexture(container);
+    for (uint32_t i = 0; i < header.mipCount; i++) {
+        const TextureContainerLevel& level = container.levels[i];
+        const unsigned char* pixels = container.file.data + level.offset;
+        if (header.format == TEXTURE_FORMAT_RGBA8) {
+            glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level.width, level.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        } else {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level.width, level.height, containerInternalFormat(header.format), static_cast<GLsizei>(level.size), pixels);
+        }
+    }
+    return textureID;
+}
+
+// Identity of an image file: where it lives and what it contains
+struct TextureKey {
+    std::string canonicalPath;
+    uint64_t contentHash = 0;
+    bool valid = false; // False when the file could not be read
+};
+
+// Resolve the canonical path and hash the file contents, safe to call from worker threads
+TextureKey makeTextureKey(const std::string& path) {
+    TextureKey key;
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    key.canonicalPath = error ? path : canonical.string();
+    key.valid = hashFile(path, key.contentHash);
+    return key;
+}
+
+// Map the container next to the image if it matches the image and the driver
+// can sample its format, safe to call from worker threads
+bool openTextureContainer(const TextureKey& key, TextureContainer& container) {
+    if (!key.valid || !container.file.open(textureContainerPath(key.canonicalPath))) return false;
+    if (!parseTextureContainer(container.file, key.contentHash, container.header, container.levels) || !textureFormatSupported(container.header.format)) {
+        container.file.close();
+        return false;
+    }
+    return true;
+}
+
+// Reference-counted textures shared by path and by content, so each image is
+// decoded and uploaded once no matter how many meshes or models use it
+struct TextureCache {
+    struct Entry {
+        int refCount = 0;
+        uint64_t contentHash = 0;
+        std::vector<std::string> paths; // Every path that resolved to this texture
+    };
+
+    std::unordered_map<GLuint, Entry> entries;
+    std::unordered_map<std::string, GLuint> byPath;
+    std::unordered_map<uint64_t, GLuint> byHash;
+    std::mutex mutex; // Workers call contains() while the GL thread updates the maps
+
+    size_t hits = 0;
+    size_t misses = 0;
+
+    // Lets loader threads skip decoding images that are already resident
+    bool contains(const TextureKey& key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return byPath.count(key.canonicalPath) || (key.valid && byHash.count(key.contentHash));
+    }
+
+    // Return a texture for the key with one more reference. On a miss the
+    // decoded image is uploaded, or else the texturetool container if there
+    // is one, or else the file is decoded now. Must run on the GL thread.
+    GLuint acquire(const TextureKey& key, const ImageData* decoded = nullptr) {
+        GLuint textureID = tryAcquire(key);
+        if (textureID != 0) return textureID;
+
+        TextureContainer container;
+        if ((!decoded || !decoded->pixels) && openTextureContainer(key, container)) {
+            return insert(key, uploadTextureContainer(container));
+        }
+
+        ImageData image;
+        if (!decoded || !decoded->pixels) {
+            decodeImage(key.canonicalPath, image);
+            decoded = &image;
+        }
+        return insert(key, uploadTexture(*decoded));
+    }
+
+    // Take a reference on a resident texture, 0 on a miss
+    GLuint tryAcquire(const TextureKey& key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        GLuint textureID = find(key);
+        if (textureID != 0) {
+            hits++;
+            entries[textureID].refCount++;
+        }
+        return textureID;
+    }
+
+    // Register a texture uploaded elsewhere, the caller gets its first reference.
+    // If the same image became resident in the meantime the new copy is deleted.
+    GLuint insert(const TextureKey& key, GLuint textureID) {
+        if (textureID == 0) return 0;
+        std::lock_guard<std::mutex> lock(mutex);
+        GLuint existing = find(key);
+        if (existing != 0) {
+            glState.deleteTexture(textureID);
+            hits++;
+            entries[existing].refCount++;
+            return existing;
+        }
+
+        misses++;
+        Entry& entry = entries[textureID];
+        entry.refCount = 1;
+        entry.contentHash = key.contentHash;
+        entry.paths.push_back(key.canonicalPath);
+        byPath[key.canonicalPath] = textureID;
+        if (key.valid) byHash[key.contentHash] = textureID;
+        return textureID;
+    }
+
+    void addRef(GLuint textureID) {
+        if (textureID == 0) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        entries[textureID].refCount++;
+    }
+
+    // Drop a reference, the texture is deleted with the last one
+    void release(GLuint textureID) {
+        if (textureID == 0) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(textureID);
+        if (it == entries.end() || --it->second.refCount > 0) return;
+
+        for (const std::string& path : it->second.paths) {
+            byPath.erase(path);
+        }
+        auto hashed = byHash.find(it->second.contentHash);
+        if (hashed != byHash.end() && hashed->second == textureID) byHash.erase(hashed);
+        entries.erase(it);
+        glState.deleteTexture(textureID);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& [textureID, entry] : entries) {
+            glState.deleteTexture(textureID);
+        }
+        entries.clear();
+        byPath.clear();
+        byHash.clear();
+    }
+
+private:
+    // Look up by path first, then by content; a content hit also remembers the new path
+    GLuint find(const TextureKey& key) {
+        auto byPathIt = byPath.find(key.canonicalPath);
+        if (byPathIt != byPath.end()) return byPathIt->second;
+        if (!key.valid) return 0;
+
+        auto byHashIt = byHash.find(key.contentHash);
+        if (byHashIt == byHash.end()) return 0;
+        byPath[key.canonicalPath] = byHashIt->second;
+        entries[byHashIt->second].paths.push_back(key.canonicalPath);
+        return byHashIt->second;
+    }
+};
+
+TextureCache textureCache;
+
+// Load a texture through the cache, the caller owns one reference
+GLuint loadTexture(const std::string& path) {
+    return textureCache.acquire(makeTextureKey(path));
+}
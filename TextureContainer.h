@@ -0,0 +1,111 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+#include <thread>
+#include <functional>
+#include "MappedFile.h"
+
+// Container written by texturetool: header, one level record per mip, then
+// the level data, each level starting on a 16 byte boundary. Fields are
+// stored in native byte order, a mismatching container is ignored.
+const char TEXTURE_CONTAINER_MAGIC[4] = { 'R', 'T', 'E', 'X' };
+const uint32_t TEXTURE_CONTAINER_VERSION = 1;
+
+enum TextureContainerFormat : uint32_t {
+    TEXTURE_FORMAT_RGBA8 = 0,
+    TEXTURE_FORMAT_BC1 = 1, // Opaque RGB, 8 bytes per 4x4 block
+    TEXTURE_FORMAT_BC3 = 2, // RGBA, 16 bytes per 4x4 block
+};
+
+struct TextureContainerHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash; // Hash of the source image file
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t mipCount;
+};
+
+struct TextureContainerLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset; // From the start of the file
+    uint64_t size;
+};
+
+std::string textureContainerPath(const std::string& imagePath) {
+    return imagePath + ".rtex";
+}
+
+// Bytes needed for one level in the given format
+size_t textureLevelSize(uint32_t format, uint32_t width, uint32_t height) {
+    if (format == TEXTURE_FORMAT_RGBA8) return static_cast<size_t>(width) * height * 4;
+    size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+    return blocks * (format == TEXTURE_FORMAT_BC1 ? 8 : 16);
+}
+
+// Validate a mapped container against the source hash and locate its levels
+bool parseTextureContainer(const MappedFile& file, uint64_t sourceHash, TextureContainerHeader& header, const TextureContainerLevel*& levels) {
+    if (!file.data || file.size < sizeof(TextureContainerHeader)) return false;
+    std::memcpy(&header, file.data, sizeof(TextureContainerHeader));
+    if (std::memcmp(header.magic, TEXTURE_CONTAINER_MAGIC, 4) != 0 || header.version != TEXTURE_CONTAINER_VERSION) return false;
+    if (header.sourceHash != sourceHash || header.format > TEXTURE_FORMAT_BC3 || header.mipCount == 0 || header.mipCount > 32) return false;
+
+    size_t tableEnd = sizeof(TextureContainerHeader) + header.mipCount * sizeof(TextureContainerLevel);
+    if (file.size < tableEnd) return false;
+    levels = reinterpret_cast<const TextureContainerLevel*>(file.data + sizeof(TextureContainerHeader));
+    for (uint32_t i = 0; i < header.mipCount; i++) {
+        const TextureContainerLevel& level = levels[i];
+        if (level.size != textureLevelSize(header.format, level.width, level.height)) return false;
+        if (level.offset < tableEnd || level.offset + level.size > file.size) return false;
+    }
+    return true;
+}
+
+size_t alignTo16(size_t size) {
+    return (size + 15) & ~static_cast<size_t>(15);
+}
+
+// Write through a temporary file so a reader never sees a half written container
+bool writeTextureContainer(const std::string& containerPath, TextureContainerHeader header, const std::vector<std::vector<unsigned char>>& levelData, const std::vector<TextureContainerLevel>& levelSizes) {
+    std::memcpy(header.magic, TEXTURE_CONTAINER_MAGIC, 4);
+    header.version = TEXTURE_CONTAINER_VERSION;
+    header.mipCount = static_cast<uint32_t>(levelData.size());
+
+    std::vector<TextureContainerLevel> levels = levelSizes;
+    size_t offset = alignTo16(sizeof(TextureContainerHeader) + levels.size() * sizeof(TextureContainerLevel));
+    for (size_t i = 0; i < levels.size(); i++) {
+        levels[i].offset = offset;
+        levels[i].size = levelData[i].size();
+        offset = alignTo16(offset + levelData[i].size());
+    }
+
+    std::string tempPath = containerPath + ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) return false;
+
+    const unsigned char padding[16] = {};
+    size_t written = sizeof(header) + levels.size() * sizeof(TextureContainerLevel);
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && std::fwrite(levels.data(), sizeof(TextureContainerLevel), levels.size(), file) == levels.size();
+    for (size_t i = 0; i < levels.size() && ok; i++) {
+        size_t paddingSize = levels[i].offset - written;
+        ok = std::fwrite(padding, 1, paddingSize, file) == paddingSize;
+        ok = ok && std::fwrite(levelData[i].data(), 1, levelData[i].size(), file) == levelData[i].size();
+        written = levels[i].offset + levelData[i].size();
+    }
+    ok = std::fclose(file) == 0 && ok;
+
+    std::error_code error;
+    if (ok) std::filesystem::rename(tempPath, containerPath, error);
+    if (!ok || error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
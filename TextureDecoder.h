@@ -0,0 +1,184 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <GL/glew.h>
+#include "Texture.h"
+#include "JobSystem.h"
+#include "TextureStreamer.h"
+
+// One image asked for by a loader. Workers fill in the key and decode it,
+// the texture streamer uploads it and the GL thread marks it done.
+struct TextureRequest {
+    std::string path;
+    TextureKey key;
+    bool queued = false;  // False when there were no decode workers to take it
+    bool done = false;    // Only touched on the GL thread
+    GLuint textureID = 0; // Holds one cache reference once done
+};
+
+struct DecodedImage {
+    std::shared_ptr<TextureRequest> request;
+    ImageData image; // Empty when the texture was already resident or comes from a container
+    std::shared_ptr<TextureContainer> container; // Precomputed mips and compression, uploaded as is
+    bool failed = false;
+};
+
+// Decodes images on its own threads so a model with many materials decodes
+// them side by side instead of one after another on the loading thread.
+// Finished pixels wait in a bounded queue, which caps how much decoded memory
+// can exist before the GL thread uploads it.
+struct TextureDecodePool {
+    std::vector<std::thread> workers;
+    std::deque<std::shared_ptr<TextureRequest>> requests;
+    std::mutex requestMutex;
+    std::condition_variable requestAvailable;
+    bool stopping = false;
+
+    BoundedQueue<DecodedImage> decoded{ 16 };
+
+    // Defaults to one decoder per core, they mostly wait on disk and zlib
+    void start(unsigned int workerCount = 0, size_t maxDecodedImages = 16) {
+        if (workerCount == 0) {
+            unsigned int cores = std::thread::hardware_concurrency();
+            workerCount = cores > 0 ? cores : 1;
+        }
+        stopping = false;
+        decoded.capacity = maxDecodedImages;
+        decoded.reopen();
+        for (unsigned int i = 0; i < workerCount; i++) {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(requestMutex);
+            stopping = true;
+            requests.clear();
+        }
+        requestAvailable.notify_all();
+        decoded.close(); // Unblocks workers waiting for room
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    // Queue an image for decoding, safe to call from any thread
+    std::shared_ptr<TextureRequest> request(const std::string& path) {
+        auto textureRequest = std::make_shared<TextureRequest>();
+        textureRequest->path = path;
+        if (workers.empty()) return textureRequest; // wait() decodes it on the GL thread
+
+        textureRequest->queued = true;
+        {
+            std::lock_guard<std::mutex> lock(requestMutex);
+            requests.push_back(textureRequest);
+        }
+        requestAvailable.notify_one();
+        return textureRequest;
+    }
+
+    // True once wait() would not block
+    bool isReady(const std::shared_ptr<TextureRequest>& textureRequest) const {
+        return textureRequest->done || !textureRequest->queued;
+    }
+
+    // Hand decoded images to the texture streamer until the queue is empty or the budget is spent, must run on the GL thread
+    void processDecodedImages(double budgetSeconds) {
+        auto start = std::chrono::steady_clock::now();
+        DecodedImage item;
+        while (decoded.tryPop(item)) {
+            finish(item);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() >= budgetSeconds) return;
+        }
+    }
+
+    // Block until the request is uploaded and return its texture, must run on the GL thread.
+    // Other images that arrive first are uploaded on the way so the queue keeps draining,
+    // and the streamer runs without a byte budget while waiting. Between passes the
+    // GL thread sleeps until the streamer's copy thread finishes a buffer.
+    GLuint wait(const std::shared_ptr<TextureRequest>& textureRequest) {
+        if (!textureRequest->queued && !textureRequest->done) {
+            textureRequest->textureID = loadTexture(textureRequest->path);
+            textureRequest->done = true;
+        }
+        DecodedImage item;
+        while (!textureRequest->done) {
+            if (decoded.tryPop(item)) {
+                finish(item);
+            } else if (textureStreamer.busy()) {
+                textureStreamer.update(SIZE_MAX);
+                textureStreamer.waitForCopy();
+            } else if (decoded.pop(item)) {
+                finish(item);
+            } else {
+                break; // Pool stopped
+            }
+        }
+        return textureRequest->textureID;
+    }
+
+private:
+    void finish(DecodedImage& item) {
+        std::shared_ptr<TextureRequest> textureRequest = std::move(item.request);
+        GLuint textureID = textureCache.tryAcquire(textureRequest->key);
+        if (textureID != 0 || item.failed) {
+            textureRequest->textureID = textureID;
+            textureRequest->done = true;
+        } else if (item.container) {
+            // Already compressed with its mips, streamed level by level under the same byte budget
+            textureStreamer.upload(std::move(item.container), [textureRequest](GLuint streamedID) {
+                textureRequest->textureID = textureCache.insert(textureRequest->key, streamedID);
+                textureRequest->done = true;
+            });
+        } else if (!item.image.pixels) {
+            // Was resident when the worker checked but has been released since
+            textureRequest->textureID = textureCache.acquire(textureRequest->key);
+            textureRequest->done = true;
+        } else {
+            textureStreamer.upload(std::move(item.image), [textureRequest](GLuint streamedID) {
+                textureRequest->textureID = textureCache.insert(textureRequest->key, streamedID);
+                textureRequest->done = true;
+            });
+        }
+        item = DecodedImage{};
+    }
+
+    void workerLoop() {
+        while (true) {
+            std::shared_ptr<TextureRequest> textureRequest;
+            {
+                std::unique_lock<std::mutex> lock(requestMutex);
+                requestAvailable.wait(lock, [this]() { return stopping || !requests.empty(); });
+                if (stopping) return;
+                textureRequest = std::move(requests.front());
+                requests.pop_front();
+            }
+
+            DecodedImage item;
+            item.request = textureRequest;
+            textureRequest->key = makeTextureKey(textureRequest->path);
+            if (!textureCache.contains(textureRequest->key)) {
+                auto container = std::make_shared<TextureContainer>();
+                if (openTextureContainer(textureRequest->key, *container)) {
+                    item.container = std::move(container);
+                } else {
+                    item.failed = !decodeImage(textureRequest->path, item.image);
+                }
+            }
+            if (!decoded.push(std::move(item))) return; // Pool is stopping
+        }
+    }
+};
+
+TextureDecodePool textureDecodePool;
@@ -0,0 +1,334 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <GL/glew.h>
+#include "Texture.h"
+
+// Streams decoded images and texturetool containers into textures through a
+// ring of pixel buffer objects. A copy thread of its own fills the mapped
+// buffers, so the copies never queue behind mesh imports on the job system,
+// and the GL thread only issues the buffer-to-texture copies, a few rows at a
+// time, so a big texture is spread over several frames instead of stalling one.
+// Container levels go through the same ring, a row of a compressed level is
+// one row of 4x4 blocks.
+struct TextureStreamer {
+    struct Upload {
+        std::shared_ptr<ImageData> image;            // Decoded pixels, mipmaps are generated at the end
+        std::shared_ptr<TextureContainer> container; // Or every stored level of a container
+        GLuint textureID = 0;
+        GLenum format = GL_RGBA;
+        int levelCount = 1;
+        int level = 0;        // Level rows are handed out from
+        size_t rowBytes = 0;  // Of that level
+        int rowCount = 0;
+        int nextRow = 0;      // First row not handed to a buffer yet
+        size_t bytesLeft = 0; // Not yet copied into the texture, done at 0
+        std::function<void(GLuint)> onComplete;
+    };
+
+    struct Slot {
+        GLuint buffer = 0;
+        void* mapped = nullptr; // Non-null while a worker is filling it
+        std::shared_ptr<std::atomic<bool>> copied;
+        std::shared_ptr<Upload> upload;
+        int level = 0;
+        int firstRow = 0;
+        int rowCount = 0;
+        size_t bytes = 0;
+    };
+
+    // Rows to copy into a mapped buffer on the copy thread
+    struct CopyJob {
+        void* destination;
+        const unsigned char* source;
+        size_t bytes;
+        std::shared_ptr<const void> pixels; // Keeps the image or mapping alive until the copy is done
+        std::shared_ptr<std::atomic<bool>> copied;
+    };
+
+    std::vector<Slot> slots;
+    std::deque<std::shared_ptr<Upload>> uploads; // Waiting for rows to be handed out
+    size_t chunkBytes = 256 * 1024;              // Bytes per buffer fill
+    size_t maxSlots = 32;                        // Ring size cap, the ring grows to cover the byte budget
+
+    std::thread copyThread;
+    std::deque<CopyJob> copyJobs;
+    std::mutex copyMutex;
+    std::condition_variable copyAvailable;
+    std::condition_variable copyFinished;
+    size_t copiesPending = 0;
+    size_t copiesCompleted = 0;
+    bool copyStopping = false;
+
+    size_t bytesThisFrame = 0;
+    size_t bytesLastFrame = 0;
+
+    void create(size_t ringSize = 4) {
+        growRing(ringSize);
+        copyStopping = false;
+        copyThread = std::thread([this]() { copyLoop(); });
+    }
+
+    // Stops the copy thread first, so nothing still writes into a buffer
+    void destroy() {
+        if (copyThread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(copyMutex);
+                copyStopping = true;
+            }
+            copyAvailable.notify_all();
+            copyThread.join();
+        }
+        copyJobs.clear();
+        copiesPending = 0;
+
+        for (Slot& slot : slots) {
+            if (slot.mapped) {
+                glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                glState.deleteTexture(slot.upload->textureID);
+                slot.upload->textureID = 0;
+            }
+            glState.deleteBuffer(slot.buffer);
+        }
+        glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        slots.clear();
+        for (const std::shared_ptr<Upload>& upload : uploads) {
+            glState.deleteTexture(upload->textureID);
+        }
+        uploads.clear();
+    }
+
+    bool busy() const {
+        if (!uploads.empty()) return true;
+        for (const Slot& slot : slots) {
+            if (slot.mapped) return true;
+        }
+        return false;
+    }
+
+    // Start streaming an image, onComplete gets the finished texture (0 on failure) on the GL thread
+    void upload(ImageData image, std::function<void(GLuint)> onComplete) {
+        if (!image.pixels) {
+            onComplete(0);
+            return;
+        }
+
+        auto pending = std::make_shared<Upload>();
+        pending->format = (image.channels == 1) ? GL_RED : (image.channels == 3) ? GL_RGB : GL_RGBA;
+        pending->rowBytes = static_cast<size_t>(image.width) * image.channels;
+        pending->rowCount = image.height;
+        pending->bytesLeft = pending->rowBytes * image.height;
+        pending->onComplete = std::move(onComplete);
+
+        // Allocate the storage now, the pixels follow over the next frames
+        glGenTextures(1, &pending->textureID);
+        glState.bindTexture(0, pending->textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, pending->format, image.width, image.height, 0, pending->format, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        pending->image = std::make_shared<ImageData>(std::move(image));
+        uploads.push_back(std::move(pending));
+    }
+
+    // Start streaming a container's levels as stored, onComplete as above
+    void upload(std::shared_ptr<TextureContainer> container, std::function<void(GLuint)> onComplete) {
+        auto pending = std::make_shared<Upload>();
+        pending->format = containerInternalFormat(container->header.format);
+        pending->levelCount = static_cast<int>(container->header.mipCount);
+        for (int i = 0; i < pending->levelCount; i++) {
+            pending->bytesLeft += container->levels[i].size;
+        }
+        pending->onComplete = std::move(onComplete);
+        pending->textureID = allocateContainerTexture(*container);
+        pending->container = std::move(container);
+        startLevel(*pending, 0);
+        uploads.push_back(std::move(pending));
+    }
+
+    // Rotate the per-frame byte counter, call once at the start of a frame
+    void beginFrame() {
+        bytesLastFrame = bytesThisFrame;
+        bytesThisFrame = 0;
+    }
+
+    // Copy filled buffers into their textures until this frame has uploaded
+    // byteBudget bytes, handing freed buffers back to the copy thread as it
+    // goes. Passes repeat while copies keep finishing, so the budget is not
+    // capped at one ring's worth per frame. GL thread only.
+    void update(size_t byteBudget) {
+        if (slots.empty()) create();
+
+        // Enough buffers in flight to fill the budget next frame
+        size_t wanted = byteBudget / chunkBytes + 1;
+        if (wanted > slots.size()) growRing(std::min(wanted, maxSlots));
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Rows are tightly packed
+        bool uploaded;
+        do {
+            uploaded = uploadFinished(byteBudget);
+        } while (uploaded && bytesThisFrame < byteBudget);
+        // Client memory uploads elsewhere need the unpack buffer unbound
+        glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    // Block until the copy thread finishes at least one buffer, returns
+    // straight away when there is nothing to copy. GL thread only.
+    void waitForCopy() {
+        std::unique_lock<std::mutex> lock(copyMutex);
+        size_t completed = copiesCompleted;
+        copyFinished.wait(lock, [this, completed]() { return copiesPending == 0 || copiesCompleted != completed; });
+    }
+
+private:
+    // One pass over the ring: upload the buffers that are copied, then refill
+    // the free ones. Returns whether anything reached a texture.
+    bool uploadFinished(size_t byteBudget) {
+        bool uploaded = false;
+        for (Slot& slot : slots) {
+            if (!slot.mapped || !slot.copied->load(std::memory_order_acquire)) continue;
+            // Always let the first copy of a frame through so oversized rows still progress
+            if (bytesThisFrame > 0 && bytesThisFrame + slot.bytes > byteBudget) continue;
+
+            Upload& pending = *slot.upload;
+            glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glState.bindTexture(0, pending.textureID);
+            copyToTexture(pending, slot);
+            slot.mapped = nullptr;
+            bytesThisFrame += slot.bytes;
+
+            pending.bytesLeft -= slot.bytes;
+            if (pending.bytesLeft == 0) {
+                if (pending.image) glGenerateMipmap(GL_TEXTURE_2D);
+                pending.onComplete(pending.textureID);
+            }
+            slot.upload.reset();
+            uploaded = true;
+        }
+
+        for (Slot& slot : slots) {
+            if (slot.mapped || uploads.empty()) continue;
+            fill(slot);
+        }
+        return uploaded;
+    }
+
+    // Point the upload at the rows of a container level
+    void startLevel(Upload& pending, int level) {
+        const TextureContainerLevel& stored = pending.container->levels[level];
+        bool compressed = pending.container->header.format != TEXTURE_FORMAT_RGBA8;
+        pending.level = level;
+        pending.rowCount = compressed ? (stored.height + 3) / 4 : stored.height;
+        pending.rowBytes = stored.size / pending.rowCount;
+        pending.nextRow = 0;
+    }
+
+    // Copy the slot's rows from the bound unpack buffer into the bound texture
+    void copyToTexture(const Upload& pending, const Slot& slot) {
+        if (pending.image) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, slot.firstRow, pending.image->width, slot.rowCount, pending.format, GL_UNSIGNED_BYTE, nullptr);
+            return;
+        }
+        const TextureContainerLevel& stored = pending.container->levels[slot.level];
+        if (pending.container->header.format == TEXTURE_FORMAT_RGBA8) {
+            glTexSubImage2D(GL_TEXTURE_2D, slot.level, 0, slot.firstRow, stored.width, slot.rowCount, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        } else {
+            // Block rows are 4 pixels high, the last one may be cut off by the level's edge
+            int y = slot.firstRow * 4;
+            int height = std::min(slot.rowCount * 4, static_cast<int>(stored.height) - y);
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, slot.level, 0, y, stored.width, height, pending.format, static_cast<GLsizei>(slot.bytes), nullptr);
+        }
+    }
+
+    void growRing(size_t ringSize) {
+        size_t oldSize = slots.size();
+        slots.resize(ringSize);
+        for (size_t i = oldSize; i < slots.size(); i++) {
+            glGenBuffers(1, &slots[i].buffer);
+        }
+    }
+
+    void copyLoop() {
+        while (true) {
+            CopyJob job;
+            {
+                std::unique_lock<std::mutex> lock(copyMutex);
+                copyAvailable.wait(lock, [this]() { return copyStopping || !copyJobs.empty(); });
+                if (copyStopping) return;
+                job = std::move(copyJobs.front());
+                copyJobs.pop_front();
+            }
+            std::memcpy(job.destination, job.source, job.bytes);
+            job.copied->store(true, std::memory_order_release);
+            {
+                std::lock_guard<std::mutex> lock(copyMutex);
+                copiesPending--;
+                copiesCompleted++;
+            }
+            copyFinished.notify_all();
+        }
+    }
+
+    // Orphan the buffer, map it and let the copy thread fill it with the next rows of the oldest upload
+    void fill(Slot& slot) {
+        std::shared_ptr<Upload> pending = uploads.front();
+        size_t rowsPerChunk = std::max<size_t>(1, chunkBytes / pending->rowBytes);
+        int rowCount = static_cast<int>(std::min<size_t>(rowsPerChunk, pending->rowCount - pending->nextRow));
+        size_t bytes = rowCount * pending->rowBytes;
+
+        glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!mapped) return;
+
+        slot.mapped = mapped;
+        slot.upload = pending;
+        slot.level = pending->level;
+        slot.firstRow = pending->nextRow;
+        slot.rowCount = rowCount;
+        slot.bytes = bytes;
+        slot.copied = std::make_shared<std::atomic<bool>>(false);
+
+        const unsigned char* source;
+        std::shared_ptr<const void> pixels;
+        if (pending->image) {
+            source = pending->image->pixels + slot.firstRow * pending->rowBytes;
+            pixels = pending->image;
+        } else {
+            source = pending->container->file.data + pending->container->levels[slot.level].offset + slot.firstRow * pending->rowBytes;
+            pixels = pending->container;
+        }
+
+        pending->nextRow += rowCount;
+        if (pending->nextRow == pending->rowCount) {
+            if (pending->level + 1 < pending->levelCount) {
+                startLevel(*pending, pending->level + 1);
+            } else {
+                uploads.pop_front();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(copyMutex);
+            copyJobs.push_back({ mapped, source, bytes, std::move(pixels), slot.copied });
+            copiesPending++;
+        }
+        copyAvailable.notify_one();
+    }
+};
+
+TextureStreamer textureStreamer;
@@ -0,0 +1,245 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "Log.h"
+#include "Scene.h"
+#include "Easing.h"
+
+// What a tween drives on its model
+enum TweenProperty : uint8_t {
+    TWEEN_POSITION,
+    TWEEN_ROTATION,
+    TWEEN_PROPERTY_COUNT
+};
+
+// Every running tween in dense structure-of-arrays storage. The update runs
+// each step as its own pass over plain float arrays so the compiler can
+// vectorize it, and finished tweens are swap-removed so the arrays stay dense.
+// A model has at most one tween per property, a new one replaces the old.
+// Positions use X/Y/Z, rotations are quaternions in X/Y/Z/W.
+struct TweenEngine {
+    static constexpr uint32_t NO_TWEEN = UINT32_MAX;
+
+    std::vector<float> startX, startY, startZ, startW;
+    std::vector<float> endX, endY, endZ, endW;
+    std::vector<float> elapsed, duration;
+    std::vector<float> angle, inverseSinAngle; // Slerp arc, 0 blends linearly
+    std::vector<uint8_t> easing, property;
+    std::vector<ModelHandle> targets;
+
+    // Constant angular speed for rotations. Off, rotations are blended and
+    // renormalized (nlerp), which needs no trigonometry per frame.
+    bool slerpRotations = true;
+
+    // Scratch filled by update: eased time, blend weights and the interpolated values
+    std::vector<float> progress;
+    std::vector<float> weightStart, weightEnd;
+    std::vector<float> valueX, valueY, valueZ, valueW;
+
+    // Tween indices grouped by easing curve, and each group's times packed
+    // together so one batch kernel call eases a whole group
+    std::vector<uint32_t> easingOrder;
+    std::vector<float> easingInput, easingOutput;
+
+    // Model slot to tween index, one table per property
+    std::vector<uint32_t> bySlot[TWEEN_PROPERTY_COUNT];
+
+    size_t size() const {
+        return targets.size();
+    }
+
+    // Rotations only start through startRotation, W unused here
+    void startPosition(ModelHandle target, const glm::vec3& from, const glm::vec3& to, float seconds, EaseType ease = EASE_LINEAR) {
+        uint32_t i = acquire(target, TWEEN_POSITION, seconds, ease);
+        startX[i] = from.x; startY[i] = from.y; startZ[i] = from.z; startW[i] = 0.0f;
+        endX[i] = to.x; endY[i] = to.y; endZ[i] = to.z; endW[i] = 0.0f;
+        angle[i] = 0.0f;
+        inverseSinAngle[i] = 0.0f;
+    }
+
+    void startRotation(ModelHandle target, const glm::quat& from, glm::quat to, float seconds, EaseType ease = EASE_LINEAR) {
+        uint32_t i = acquire(target, TWEEN_ROTATION, seconds, ease);
+
+        // q and -q are the same rotation, take the one on the short arc
+        float cosine = glm::dot(from, to);
+        if (cosine < 0.0f) {
+            to = -to;
+            cosine = -cosine;
+        }
+        startX[i] = from.x; startY[i] = from.y; startZ[i] = from.z; startW[i] = from.w;
+        endX[i] = to.x; endY[i] = to.y; endZ[i] = to.z; endW[i] = to.w;
+
+        // The arc is fixed for the whole tween, so its sine is worked out once here.
+        // Nearly equal rotations blend linearly where slerp would divide by ~0.
+        float theta = std::acos(std::min(cosine, 1.0f));
+        bool useSlerp = slerpRotations && theta > 1e-3f;
+        angle[i] = useSlerp ? theta : 0.0f;
+        inverseSinAngle[i] = useSlerp ? 1.0f / std::sin(theta) : 0.0f;
+    }
+
+    // Drop every tween driving the model
+    void stop(ModelHandle target) {
+        for (int p = 0; p < TWEEN_PROPERTY_COUNT; p++) {
+            const std::vector<uint32_t>& lookup = bySlot[p];
+            if (target.index >= lookup.size()) continue;
+            uint32_t i = lookup[target.index];
+            if (i != NO_TWEEN && targets[i] == target) removeAt(i);
+        }
+    }
+
+    // Advance every tween by deltaTime seconds and write the results into the scene
+    void update(float deltaTime) {
+        const size_t count = size();
+        if (count == 0) return;
+        progress.resize(count);
+        weightStart.resize(count);
+        weightEnd.resize(count);
+        valueX.resize(count);
+        valueY.resize(count);
+        valueZ.resize(count);
+        valueW.resize(count);
+
+        // Normalized time, a zero duration finishes on the first update
+        float* time = elapsed.data();
+        const float* length = duration.data();
+        float* t = progress.data();
+        for (size_t i = 0; i < count; i++) {
+            time[i] += deltaTime;
+            t[i] = length[i] > 0.0f ? std::min(time[i] / length[i], 1.0f) : 1.0f;
+        }
+
+        easeProgress(t, count);
+
+        // Weights of the two ends: (1 - t, t) for lerp and nlerp, the sine
+        // ratios for slerp
+        float* w0 = weightStart.data();
+        float* w1 = weightEnd.data();
+        const float* theta = angle.data();
+        const float* inverseSin = inverseSinAngle.data();
+        for (size_t i = 0; i < count; i++) {
+            if (theta[i] > 0.0f) {
+                w0[i] = std::sin((1.0f - t[i]) * theta[i]) * inverseSin[i];
+                w1[i] = std::sin(t[i] * theta[i]) * inverseSin[i];
+            } else {
+                w0[i] = 1.0f - t[i];
+                w1[i] = t[i];
+            }
+        }
+
+        // Blend each component as its own stream
+        blend(startX.data(), endX.data(), w0, w1, valueX.data(), count);
+        blend(startY.data(), endY.data(), w0, w1, valueY.data(), count);
+        blend(startZ.data(), endZ.data(), w0, w1, valueZ.data(), count);
+        blend(startW.data(), endW.data(), w0, w1, valueW.data(), count);
+
+        for (size_t i = 0; i < count; i++) {
+            int index = sceneStore.indexOf(targets[i]);
+            if (index < 0) continue; // The model is gone, compacted below
+            if (property[i] == TWEEN_POSITION) {
+                sceneStore.positions[index] = glm::vec3(valueX[i], valueY[i], valueZ[i]);
+            } else {
+                sceneStore.rotations[index] = glm::normalize(glm::quat(valueW[i], valueX[i], valueY[i], valueZ[i]));
+            }
+            sceneStore.markTransformDirty(index);
+        }
+
+        // Walk backwards so every tween swapped into a freed spot was already checked
+        for (size_t i = count; i-- > 0;) {
+            bool alive = sceneStore.isValid(targets[i]);
+            if (alive && time[i] < length[i]) continue;
+            if (alive) LOG_DEBUG << "INFO::TWEEN Tween complete for model " << targets[i].index;
+            removeAt(static_cast<uint32_t>(i));
+        }
+    }
+
+    void clear() {
+        for (std::vector<float>* column : floatColumns()) column->clear();
+        easing.clear();
+        property.clear();
+        targets.clear();
+        for (std::vector<uint32_t>& lookup : bySlot) lookup.clear();
+    }
+
+private:
+    // Counting sort the tweens by curve, then gather, ease and scatter each
+    // group. Linear tweens are left as they are.
+    void easeProgress(float* t, size_t count) {
+        uint32_t offsets[257] = {};
+        for (size_t i = 0; i < count; i++) offsets[easing[i] + 1]++;
+        if (offsets[EASE_LINEAR + 1] == count) return;
+        for (int type = 0; type < 256; type++) offsets[type + 1] += offsets[type];
+
+        easingOrder.resize(count);
+        uint32_t cursor[256];
+        std::copy(offsets, offsets + 256, cursor);
+        for (size_t i = 0; i < count; i++) easingOrder[cursor[easing[i]]++] = static_cast<uint32_t>(i);
+
+        easingInput.resize(count);
+        easingOutput.resize(count);
+        for (int type = EASE_LINEAR + 1; type < 256; type++) {
+            uint32_t first = offsets[type];
+            uint32_t last = offsets[type + 1];
+            if (first == last) continue;
+            for (uint32_t k = first; k < last; k++) easingInput[k] = t[easingOrder[k]];
+            easeBatch(static_cast<uint8_t>(type), easingInput.data() + first, easingOutput.data() + first, last - first);
+            for (uint32_t k = first; k < last; k++) t[easingOrder[k]] = easingOutput[k];
+        }
+    }
+
+    std::array<std::vector<float>*, 12> floatColumns() {
+        return { &startX, &startY, &startZ, &startW, &endX, &endY, &endZ, &endW, &elapsed, &duration, &angle, &inverseSinAngle };
+    }
+
+    // Index of the model's tween on the property, appended if it has none
+    uint32_t acquire(ModelHandle target, TweenProperty tweenProperty, float seconds, EaseType ease) {
+        std::vector<uint32_t>& lookup = bySlot[tweenProperty];
+        if (lookup.size() <= target.index) lookup.resize(target.index + 1, NO_TWEEN);
+
+        uint32_t i = lookup[target.index];
+        if (i == NO_TWEEN) {
+            i = static_cast<uint32_t>(size());
+            lookup[target.index] = i;
+            for (std::vector<float>* column : floatColumns()) column->push_back(0.0f);
+            easing.push_back(EASE_LINEAR);
+            property.push_back(tweenProperty);
+            targets.push_back(target);
+        }
+        elapsed[i] = 0.0f;
+        duration[i] = seconds;
+        easing[i] = ease;
+        targets[i] = target;
+        return i;
+    }
+
+    static void blend(const float* from, const float* to, const float* w0, const float* w1, float* out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = from[i] * w0[i] + to[i] * w1[i];
+        }
+    }
+
+    // Move the last tween into slot i and shrink every array by one
+    void removeAt(uint32_t i) {
+        bySlot[property[i]][targets[i].index] = NO_TWEEN;
+        uint32_t last = static_cast<uint32_t>(size() - 1);
+        if (i != last) {
+            for (std::vector<float>* column : floatColumns()) {
+                (*column)[i] = (*column)[last];
+            }
+            easing[i] = easing[last];
+            property[i] = property[last];
+            targets[i] = targets[last];
+            bySlot[property[i]][targets[i].index] = i;
+        }
+        for (std::vector<float>* column : floatColumns()) column->pop_back();
+        easing.pop_back();
+        property.pop_back();
+        targets.pop_back();
+    }
+};
+
+TweenEngine tweenEngine;
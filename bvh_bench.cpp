@@ -0,0 +1,113 @@
+// Standalone benchmark for the scene BVH: build, refit and query throughput
+// against the number of objects. Build with `make bench`.
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Bvh.h"
+
+using Clock = std::chrono::high_resolution_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t maxObjects = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    const int rayCount = 10000;
+    const float worldSize = 1000.0f;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-worldSize * 0.5f, worldSize * 0.5f);
+    std::uniform_real_distribution<float> extent(0.5f, 2.0f);
+    std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    // Camera in the middle of the world looking down -Z
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 300.0f);
+    Frustum frustum = extractFrustum(projection * view);
+
+    std::cout << std::left << std::setw(10) << "objects"
+              << std::setw(14) << "build ms"
+              << std::setw(14) << "refit ms"
+              << std::setw(14) << "bvh cull ms"
+              << std::setw(14) << "flat cull ms"
+              << std::setw(14) << "visible"
+              << std::setw(14) << "rays/ms" << std::endl;
+
+    for (size_t count = 1000; count <= maxObjects; count *= 10) {
+        std::vector<AABB> bounds(count);
+        std::vector<float> x(count), y(count), z(count), radius(count);
+        for (size_t i = 0; i < count; i++) {
+            glm::vec3 center(position(rng), position(rng), position(rng));
+            glm::vec3 halfSize(extent(rng));
+            bounds[i] = { center - halfSize, center + halfSize };
+            x[i] = center.x;
+            y[i] = center.y;
+            z[i] = center.z;
+            radius[i] = glm::length(halfSize);
+        }
+
+        // Build by incremental insertion
+        DynamicBvh bvh;
+        std::vector<int32_t> proxies(count);
+        auto start = Clock::now();
+        for (size_t i = 0; i < count; i++) {
+            proxies[i] = bvh.insert(bounds[i], static_cast<uint32_t>(i));
+        }
+        double buildTime = millisecondsSince(start);
+
+        // Refit after every object moved a little, as tweens do each frame
+        for (AABB& box : bounds) {
+            glm::vec3 offset(jitter(rng), jitter(rng), jitter(rng));
+            box.min += offset;
+            box.max += offset;
+        }
+        start = Clock::now();
+        for (size_t i = 0; i < count; i++) {
+            bvh.move(proxies[i], bounds[i]);
+        }
+        double refitTime = millisecondsSince(start);
+
+        // Hierarchical frustum cull
+        std::vector<uint32_t> visible;
+        visible.reserve(count);
+        start = Clock::now();
+        bvh.cullFrustum(frustum, visible);
+        double bvhCullTime = millisecondsSince(start);
+        size_t visibleCount = visible.size();
+
+        // Flat SIMD sphere cull for comparison
+        visible.clear();
+        start = Clock::now();
+        cullSpheres(frustum, x.data(), y.data(), z.data(), radius.data(), count, visible);
+        double flatCullTime = millisecondsSince(start);
+
+        // Closest-hit rays from random origins
+        start = Clock::now();
+        for (int i = 0; i < rayCount; i++) {
+            glm::vec3 origin(position(rng), position(rng), position(rng));
+            glm::vec3 direction(unit(rng), unit(rng), unit(rng));
+            if (glm::length(direction) < 1e-3f) direction = glm::vec3(0.0f, 0.0f, -1.0f);
+            direction = glm::normalize(direction);
+            uint32_t hit;
+            float distance;
+            bvh.raycast(origin, direction, worldSize, hit, distance);
+        }
+        double rayTime = millisecondsSince(start);
+
+        std::cout << std::left << std::setw(10) << count << std::fixed << std::setprecision(3)
+                  << std::setw(14) << buildTime
+                  << std::setw(14) << refitTime
+                  << std::setw(14) << bvhCullTime
+                  << std::setw(14) << flatCullTime
+                  << std::setw(14) << visibleCount
+                  << std::setw(14) << (rayTime > 0.0 ? rayCount / rayTime : 0.0) << std::endl;
+    }
+    return 0;
+}
@@ -8,22 +8,49 @@ void checkCompileErrors(GLuint shader, const std::string& type) {
         glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
         if (!success) {
             glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n"
-                      << infoLog << "\n -- --------------------------------------------------- -- "
-                      << std::endl;
+            LOG_ERROR << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n"
+                      << infoLog << "\n -- --------------------------------------------------- -- ";
         }
     } else {
         glGetProgramiv(shader, GL_LINK_STATUS, &success);
         if (!success) {
             glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n"
-                      << infoLog << "\n -- --------------------------------------------------- -- "
-                      << std::endl;
+            LOG_ERROR << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n"
+                      << infoLog << "\n -- --------------------------------------------------- -- ";
         }
     }
 }
 
-GLuint compileShaders() {
+// Binding point of the per-frame "Matrices" uniform block
+const GLuint MATRICES_BINDING = 0;
+
+// Linked shader program with its uniform locations resolved once at link time
+struct ShaderProgram {
+    GLuint id = 0;
+    GLint useTexture = -1;
+    GLint texture1 = -1;
+    GLint useMaterialColor = -1;
+    GLint materialColor = -1;
+};
+
+// Look up every uniform the renderer sets so the frame loop never does string lookups
+void resolveUniforms(ShaderProgram& program) {
+    program.useTexture = glGetUniformLocation(program.id, "useTexture");
+    program.texture1 = glGetUniformLocation(program.id, "texture1");
+    program.useMaterialColor = glGetUniformLocation(program.id, "useMaterialColor");
+    program.materialColor = glGetUniformLocation(program.id, "materialColor");
+
+    GLuint matricesIndex = glGetUniformBlockIndex(program.id, "Matrices");
+    if (matricesIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program.id, matricesIndex, MATRICES_BINDING);
+    }
+
+    // The sampler always reads from texture unit 0
+    glState.useProgram(program.id);
+    glUniform1i(program.texture1, 0);
+}
+
+ShaderProgram compileShaders() {
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
     glCompileShader(vertexShader);
@@ -43,5 +70,8 @@ GLuint compileShaders() {
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
-    return shaderProgram;
+    ShaderProgram program;
+    program.id = shaderProgram;
+    resolveUniforms(program);
+    return program;
 }
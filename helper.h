@@ -13,26 +13,59 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/string_cast.hpp>
 #include <map>
+#include <algorithm>
+#include <memory>
+#include <limits>
+#include <cstring>
 #include <cmath>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "Log.h"
+#include "Texture.h"
+#include "Mesh.h"
+#include "Scene.h"
+#include "JobSystem.h"
+#include "TextureDecoder.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "RenderQueue.h"
+#include "TweenEngine.h"
+
 // Vertex Shader
 const char* vertexShaderSource = R"(
 #version 330 core
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec2 texCoords; // Add texture coordinates input
+layout(location = 2) in mat4 instanceModel; // Per-instance transform (locations 2-5)
+layout(location = 6) in vec4 instanceColor; // Per-instance color
+layout(location = 7) in vec2 octNormal; // Octahedral encoded normal
 
 out vec2 fragTexCoords; // Pass texture coordinates to fragment shader
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+out vec3 fragNormal; // World-space normal
+flat out vec3 fragColor; // Pass the instance color to fragment shader
+
+// Shared by every program, uploaded once per frame
+layout(std140) uniform Matrices {
+    mat4 view;
+    mat4 projection;
+};
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.xy += vec2(normal.x >= 0.0 ? -fold : fold, normal.y >= 0.0 ? -fold : fold);
+    return normal;
+}
 
 void main() {
-    gl_Position = projection * view * model * vec4(position, 1.0);
+    // Quantized positions arrive in [0, 1], the instance matrix maps them back through the mesh bounds
+    gl_Position = projection * view * instanceModel * vec4(position, 1.0);
     fragTexCoords = texCoords; // Pass texture coordinates to fragment shader
+    fragNormal = mat3(instanceModel) * decodeOctahedral(octNormal);
+    fragColor = instanceColor.rgb;
 }
 )";
 
@@ -40,19 +73,28 @@ void main() {
 const char* fragmentShaderSource = R"(
 #version 330 core
 in vec2 fragTexCoords; // Receive texture coordinates from vertex shader
+in vec3 fragNormal; // Receive the normal from vertex shader
+flat in vec3 fragColor; // Receive the instance color from vertex shader
 out vec4 outColor;
 
 uniform sampler2D texture1; // Texture sampler
-uniform vec3 color; // Color uniform
 uniform bool useTexture; // Boolean to determine whether to use texture or color
+uniform bool useMaterialColor; // The submesh's material color replaces the model color
+uniform vec3 materialColor;
+
+const vec3 lightDirection = vec3(0.267, 0.802, 0.535); // Fixed key light, normalized
 
 void main() {
     if (useTexture) {
         vec4 textureColor = texture(texture1, fragTexCoords); // Sample the texture
         outColor = textureColor; // Use texture color
     } else {
-        outColor = vec4(color, 1.0); // Use the specified color
+        outColor = vec4(useMaterialColor ? materialColor : fragColor, 1.0); // Use the specified color
     }
+
+    // Soft directional shading so the surface shape reads
+    float diffuse = max(dot(normalize(fragNormal), lightDirection), 0.0);
+    outColor.rgb *= 0.7 + 0.3 * diffuse;
 }
 )";
 
@@ -60,141 +102,493 @@ GLFWwindow* window;
 
 bool locked = true;
 
-std::vector<std::tuple<GLuint, std::pair<unsigned int, glm::vec3>, std::tuple<glm::vec3, glm::vec3, glm::vec3>, GLuint>> models;
-
-GLuint loadTexture(const std::string& path) {
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    
-    // Load image
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true); // Flip loaded texture coordinates
-    unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
-    
-    if (data) {
-        GLenum format = (nrChannels == 1) ? GL_RED : (nrChannels == 3) ? GL_RGB : GL_RGBA;
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        
-        // Generate texture
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        // Set texture parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    } else {
-        std::cerr << "ERROR::IMAGE-LOADING Failed to load texture: " << path << std::endl;
+// One aiMesh of the file: its ranges, material and texture
+struct SubmeshData {
+    Submesh submesh;
+    std::string texturePath;
+    std::shared_ptr<TextureRequest> textureRequest; // Diffuse texture from the material, decoded by the pool
+};
+
+// Everything read from a model file before any GL call
+struct MeshData {
+    std::string path;
+    std::vector<Vertex> vertices;   // Filled when the file is parsed with Assimp
+    std::vector<GLuint> indices;
+    MappedFile cacheFile;           // Holds the geometry when it comes from the mesh cache
+
+    // Vertex stream in the upload format, one of the two is filled after an import
+    std::vector<PackedVertex> packedVertices;
+    std::vector<FloatVertex> floatVertices;
+
+    // Geometry to upload, points into the vectors above or into the mapped cache.
+    // The vertices are PackedVertex if quantized, FloatVertex otherwise.
+    bool quantized = false;
+    const void* vertexData = nullptr;
+    size_t vertexCount = 0;
+    const GLuint* indexData = nullptr;
+    size_t indexCount = 0;          // Every submesh and LOD's indices, back to back
+    std::vector<SubmeshData> submeshes;
+
+    MeshBounds bounds;
+};
+
+// Map the binary cache next to the source file, fails if it is missing or stale
+bool readMeshCache(MeshData& data, const MeshSource& source)
+{
+    if (!data.cacheFile.open(meshCachePath(data.path))) return false;
+
+    MeshCacheHeader header;
+    const MeshCacheSubmesh* submeshes;
+    const char* strings;
+    const void* vertices;
+    const uint32_t* indices;
+    if (!parseMeshCache(data.cacheFile, source, quantizeVertices, header, submeshes, strings, vertices, indices)) {
+        data.cacheFile.close();
+        return false;
     }
 
-    stbi_image_free(data); // Free the image data
-    return textureID;
+    data.quantized = header.quantized != 0;
+    data.vertexData = vertices;
+    data.vertexCount = header.vertexCount;
+    data.indexData = indices;
+    data.indexCount = header.indexCount;
+    data.bounds.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    data.bounds.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    data.bounds.sphereCenter = glm::vec3(header.sphereCenter[0], header.sphereCenter[1], header.sphereCenter[2]);
+    data.bounds.sphereRadius = header.sphereRadius;
+
+    data.submeshes.resize(header.submeshCount);
+    for (uint32_t s = 0; s < header.submeshCount; s++) {
+        const MeshCacheSubmesh& record = submeshes[s];
+        Submesh& submesh = data.submeshes[s].submesh;
+        submesh.baseVertex = record.baseVertex;
+        submesh.vertexCount = record.vertexCount;
+        submesh.lodCount = record.lodCount;
+        std::copy(record.lods, record.lods + record.lodCount, submesh.lods);
+        submesh.hasMaterial = record.hasMaterial != 0;
+        submesh.materialColor = glm::vec3(record.materialColor[0], record.materialColor[1], record.materialColor[2]);
+        data.submeshes[s].texturePath.assign(strings + record.texturePathOffset, record.texturePathLength);
+    }
+    return true;
 }
 
-// Function to load an OBJ file using Assimp
-std::tuple<GLuint, std::pair<unsigned int, glm::vec3>, std::tuple<glm::vec3, glm::vec3, glm::vec3>, GLuint> loadModel(
-    const std::string& path, 
-    glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), 
-    glm::vec3 color = glm::vec3(0.0f, 0.0f, 0.0f), 
-    glm::vec3 scale = glm::vec3(1.0f), 
-    glm::vec3 rotationAxis = glm::vec3(0.0f, 0.0f, 0.0f),
-    const std::string& texturePath = ""
-)
+void writeMeshCache(const MeshData& data, const MeshSource& source)
 {
-    GLuint textureID = 0;
-    std::vector<GLuint> indices;
-    std::vector<glm::vec3> vertices;
-    std::vector<glm::vec2> texCoords;
+    uint64_t sourceHash;
+    if (!hashFile(source.path, sourceHash)) return;
+
+    MeshCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+    header.version = MESH_CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+    header.vertexCount = static_cast<uint32_t>(data.vertexCount);
+    header.indexCount = static_cast<uint32_t>(data.indexCount);
+    header.vertexStride = static_cast<uint32_t>(vertexStride(data.quantized));
+    header.quantized = data.quantized ? 1 : 0;
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = data.bounds.boundsMin[i];
+        header.boundsMax[i] = data.bounds.boundsMax[i];
+        header.sphereCenter[i] = data.bounds.sphereCenter[i];
+    }
+    header.sphereRadius = data.bounds.sphereRadius;
+
+    std::vector<MeshCacheSubmesh> records(data.submeshes.size());
+    std::string strings;
+    for (size_t s = 0; s < data.submeshes.size(); s++) {
+        const Submesh& submesh = data.submeshes[s].submesh;
+        MeshCacheSubmesh& record = records[s];
+        std::memset(&record, 0, sizeof(record));
+        record.baseVertex = submesh.baseVertex;
+        record.vertexCount = submesh.vertexCount;
+        record.lodCount = submesh.lodCount;
+        std::copy(submesh.lods, submesh.lods + submesh.lodCount, record.lods);
+        record.hasMaterial = submesh.hasMaterial ? 1 : 0;
+        for (int i = 0; i < 3; i++) record.materialColor[i] = submesh.materialColor[i];
+        record.texturePathOffset = static_cast<uint32_t>(strings.size());
+        record.texturePathLength = static_cast<uint32_t>(data.submeshes[s].texturePath.size());
+        strings += data.submeshes[s].texturePath;
+    }
+    header.submeshCount = static_cast<uint32_t>(records.size());
+    header.stringBytes = static_cast<uint32_t>(strings.size());
 
-    color.x /= 255.0f;
-    color.y /= 255.0f;
-    color.z /= 255.0f;
+    if (!writeMeshCache(meshCachePath(data.path), header, records, strings, data.vertexData, data.indexData)) {
+        LOG_ERROR << "ERROR::MESH-CACHE Failed to write cache for: " << data.path;
+    }
+}
 
+// Function to load an OBJ file using Assimp, safe to call from worker threads
+bool importMesh(MeshData& data)
+{
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_FixInfacingNormals | aiProcess_SortByPType);
+    const aiScene* scene = importer.ReadFile(data.path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices | aiProcess_FixInfacingNormals | aiProcess_SortByPType);
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        std::cerr << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
-        return { 0, { 0, glm::vec3(0.0f) }, { glm::vec3(1.0f), glm::vec3(1.0f), glm::vec3(0.0f) }, 0 }; 
+        LOG_ERROR << "ERROR::ASSIMP:: " << importer.GetErrorString();
+        return false;
     }
 
-    // Process each mesh in the scene
+    // Totals over every submesh for the log lines below
+    double missesBefore = 0.0, missesAfter = 0.0, uniqueBefore = 0.0, uniqueAfter = 0.0;
+    size_t triangleCount = 0;
+    std::vector<size_t> lodTriangles;
+
+    // Each aiMesh becomes a submesh with its own vertex range, index ranges and material
     for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
         aiMesh* mesh = scene->mMeshes[i];
 
+        // SortByPType moves points and lines into meshes of their own, those are not drawn
+        if (!(mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE)) continue;
+
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
+
         // Process vertices and texture coordinates
         for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
             aiVector3D pos = mesh->mVertices[j];
-            vertices.emplace_back(pos.x, pos.y, pos.z);
+            Vertex vertex;
+            vertex.position = glm::vec3(pos.x, pos.y, pos.z);
 
             if (mesh->mTextureCoords[0]) {
                 aiVector3D texCoord = mesh->mTextureCoords[0][j];
-                texCoords.emplace_back(texCoord.x, texCoord.y);
+                vertex.texCoord = glm::vec2(texCoord.x, texCoord.y);
+            } else {
+                vertex.texCoord = glm::vec2(0.0f, 0.0f);
+            }
+
+            if (mesh->mNormals) {
+                aiVector3D normal = mesh->mNormals[j];
+                vertex.normal = glm::vec3(normal.x, normal.y, normal.z);
             } else {
-                texCoords.emplace_back(0.0f, 0.0f);
+                vertex.normal = glm::vec3(0.0f, 0.0f, 1.0f);
             }
+            vertices.push_back(vertex);
         }
 
-        // Process indices
+        // Process indices, relative to the submesh's first vertex
         for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
-            aiFace face = mesh->mFaces[j];
-            for (unsigned int k = 0; k < face.mNumIndices; k++) {
-                indices.push_back(face.mIndices[k]);
-            }
+            const aiFace& face = mesh->mFaces[j];
+            if (face.mNumIndices != 3) continue;
+            indices.insert(indices.end(), face.mIndices, face.mIndices + 3);
+        }
+        if (indices.empty()) continue;
+
+        // Reorder for the vertex cache, overdraw and fetch before the cache is written
+        if (optimizeMeshes) {
+            VertexCacheStats before, after;
+            optimizeMesh(vertices, indices, before, after);
+            double triangles = static_cast<double>(indices.size() / 3);
+            missesBefore += before.acmr * triangles;
+            missesAfter += after.acmr * triangles;
+            uniqueBefore += before.acmr * triangles / before.atvr;
+            uniqueAfter += after.acmr * triangles / after.atvr;
+        }
+        triangleCount += indices.size() / 3;
+
+        // Simplified levels go after the full part in the same index list
+        std::vector<MeshLod> lods;
+        if (generateMeshLods) {
+            buildMeshLods(vertices, indices, lods);
+        } else {
+            lods = { { 0, static_cast<uint32_t>(indices.size()), 0.0f } };
+        }
+
+        SubmeshData part;
+        Submesh& submesh = part.submesh;
+        submesh.baseVertex = static_cast<uint32_t>(data.vertices.size());
+        submesh.vertexCount = static_cast<uint32_t>(vertices.size());
+        submesh.lodCount = static_cast<uint32_t>(lods.size());
+        for (size_t l = 0; l < lods.size(); l++) {
+            submesh.lods[l] = lods[l];
+            submesh.lods[l].firstIndex += static_cast<uint32_t>(data.indices.size());
+            if (lodTriangles.size() <= l) lodTriangles.push_back(0);
+            lodTriangles[l] += lods[l].indexCount / 3;
         }
 
         // Load material properties
-        if (mesh->mMaterialIndex >= 0) {
+        if (mesh->mMaterialIndex < scene->mNumMaterials) {
             aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
             aiColor3D diffuse;
             material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse);
-            color = glm::vec3(diffuse.r, diffuse.g, diffuse.b); // Use the diffuse color
-
-            // Load the texture if available
-            aiString texturePath;
-            if (material->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS) {
-                // Load texture
-                std::string fullPath = std::string(texturePath.C_Str());
-                std::cout << "INFO::IMAGE Loading Image Path:" << fullPath << "\n";
-                textureID = loadTexture(fullPath);
-                // Save the textureID or use it directly if needed
+            submesh.materialColor = glm::vec3(diffuse.r, diffuse.g, diffuse.b); // Use the diffuse color
+            submesh.hasMaterial = true;
+
+            // Remember the texture if available
+            aiString materialTexture;
+            if (material->GetTexture(aiTextureType_DIFFUSE, 0, &materialTexture) == AI_SUCCESS) {
+                part.texturePath = std::string(materialTexture.C_Str());
             }
         }
+
+        data.vertices.insert(data.vertices.end(), vertices.begin(), vertices.end());
+        data.indices.insert(data.indices.end(), indices.begin(), indices.end());
+        data.submeshes.push_back(std::move(part));
+    }
+
+    if (data.submeshes.empty()) {
+        LOG_ERROR << "ERROR::ASSIMP:: No triangles in: " << data.path;
+        return false;
+    }
+
+    if (optimizeMeshes) {
+        LOG_INFO << "INFO::MESH-OPT " << data.path << " ACMR " << missesBefore / triangleCount << " -> " << missesAfter / triangleCount
+                 << ", ATVR " << missesBefore / uniqueBefore << " -> " << missesAfter / uniqueAfter;
+    }
+    if (generateMeshLods) {
+        std::string counts;
+        for (size_t triangles : lodTriangles) counts += " " + std::to_string(triangles);
+        LOG_INFO << "INFO::MESH-LOD " << data.path << " " << lodTriangles.size() << " levels, triangles:" << counts;
+    }
+
+    data.bounds = computeMeshBounds(data.vertices.data(), data.vertices.size());
+
+    // Convert to the GPU vertex format here, the cache stores this stream and
+    // the GL thread only copies it
+    data.quantized = quantizeVertices;
+    if (data.quantized) {
+        packVertices(data.vertices.data(), data.vertices.size(), data.bounds, data.packedVertices);
+        data.vertexData = data.packedVertices.data();
+    } else {
+        packFloatVertices(data.vertices.data(), data.vertices.size(), data.floatVertices);
+        data.vertexData = data.floatVertices.data();
+    }
+    data.vertexCount = data.vertices.size();
+    data.indexData = data.indices.data();
+    data.indexCount = data.indices.size();
+    return true;
+}
+
+// Read a model from its binary cache, or import it and write the cache for next time.
+// Safe to call from worker threads.
+bool parseMesh(const std::string& path, MeshData& data)
+{
+    data.path = path;
+
+    MeshSource source;
+    bool stamped = statMeshSource(path, source);
+    if (stamped && readMeshCache(data, source)) {
+        LOG_INFO << "INFO::MESH-CACHE Mapped cache for: " << path;
+    } else {
+        if (!importMesh(data)) {
+            return false;
+        }
+        if (stamped) {
+            writeMeshCache(data, source);
+        }
+    }
+
+    // Start decoding the textures now so they overlap with the rest of the load
+    for (SubmeshData& part : data.submeshes) {
+        if (part.texturePath.empty()) continue;
+        LOG_INFO << "INFO::IMAGE Loading Image Path:" << part.texturePath;
+        part.textureRequest = textureDecodePool.request(part.texturePath);
+    }
+
+    LOG_INFO << "INFO::IMAGE Loaded " << data.vertexCount << " vertices and " << data.indexCount << " indices in " << data.submeshes.size() << " submeshes.";
+    return true;
+}
+
+// Upload parsed mesh data and register it, must run on the GL thread
+uint32_t uploadMesh(const MeshData& data)
+{
+    Mesh result;
+    result.path = data.path;
+    result.bounds = data.bounds;
+    result.dequantize = data.quantized ? dequantizeMatrix(data.bounds) : glm::mat4(1.0f);
+    result.quantized = data.quantized;
+
+    // Interleaved vertices and indices go into the shared arena for the vertex format
+    allocateGeometry(result, data.vertexData, static_cast<uint32_t>(data.vertexCount), data.indexData, static_cast<uint32_t>(data.indexCount));
+
+    // Move the submesh ranges from the file's buffers to the arena's
+    for (const SubmeshData& part : data.submeshes) {
+        Submesh submesh = part.submesh;
+        submesh.baseVertex += result.firstVertex;
+        for (uint32_t i = 0; i < submesh.lodCount; i++) {
+            submesh.lods[i].firstIndex += result.firstIndex;
+        }
+        if (part.textureRequest) {
+            submesh.textureID = textureDecodePool.wait(part.textureRequest);
+        }
+        result.lodCount = std::max(result.lodCount, submesh.lodCount);
+        result.submeshes.push_back(submesh);
+    }
+
+    return registerMesh(std::move(result));
+}
+
+// Parse and upload a mesh on the calling thread
+uint32_t loadMesh(const std::string& path)
+{
+    MeshData data;
+    if (!parseMesh(path, data)) {
+        return INVALID_MESH;
+    }
+    return uploadMesh(data);
+}
+
+// Give a model its mesh once the mesh is available. Materials stay on the
+// submeshes, textureID only covers the submeshes without a texture.
+void attachMesh(ModelHandle handle, uint32_t meshId, GLuint textureID)
+{
+    int index = sceneStore.indexOf(handle);
+    sceneStore.meshIds[index] = meshId;
+    sceneStore.textures[index] = textureID;
+    sceneStore.markTransformDirty(index); // Bounds and culling sphere come with the mesh
+}
+
+// Function to add a model to the scene, reusing the mesh if the file was loaded before
+ModelHandle loadModel(
+    const std::string& path, 
+    glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), 
+    glm::vec3 color = glm::vec3(0.0f, 0.0f, 0.0f), 
+    glm::vec3 scale = glm::vec3(1.0f), 
+    glm::vec3 rotationAxis = glm::vec3(0.0f, 0.0f, 0.0f),
+    const std::string& texturePath = ""
+)
+{
+    color.x /= 255.0f;
+    color.y /= 255.0f;
+    color.z /= 255.0f;
+
+    uint32_t meshId = acquireMesh(path);
+    if (meshId == INVALID_MESH) {
+        meshId = loadMesh(path);
+        if (meshId == INVALID_MESH) {
+            return ModelHandle{};
+        }
+    }
+
+    GLuint textureID = 0;
+    if (!texturePath.empty() && hasUntexturedSubmesh(meshes[meshId])) {
+        textureID = textureDecodePool.wait(textureDecodePool.request(texturePath));
+    }
+
+    ModelHandle handle = sceneStore.add(INVALID_MESH, position, color, scale, rotationAxis, 0);
+    attachMesh(handle, meshId, textureID);
+    return handle;
+}
+
+// Models waiting for a mesh that is still loading
+struct PendingModel {
+    ModelHandle handle;
+    std::shared_ptr<TextureRequest> texture; // Texture given to loadModelAsync, if any
+};
+
+std::unordered_map<std::string, std::vector<PendingModel>> pendingLoads;
+
+// Hand the finished mesh to every model that asked for it, runs on the GL thread
+void finishAsyncLoad(const std::shared_ptr<MeshData>& data, bool parsed)
+{
+    auto pending = pendingLoads.find(data->path);
+    if (pending == pendingLoads.end()) return;
+
+    // Wait for the decode pool without blocking the frame, try again next frame
+    bool texturesReady = true;
+    for (const SubmeshData& part : data->submeshes) {
+        texturesReady = texturesReady && (!part.textureRequest || textureDecodePool.isReady(part.textureRequest));
+    }
+    for (const PendingModel& model : pending->second) {
+        texturesReady = texturesReady && (!model.texture || textureDecodePool.isReady(model.texture));
+    }
+    if (!texturesReady) {
+        jobSystem.runOnMainThread([data, parsed]() {
+            finishAsyncLoad(data, parsed);
+        });
+        return;
     }
 
-    std::cout << "INFO::IMAGE Loaded " << vertices.size() << " vertices and " << indices.size() << " indices." << std::endl;
+    std::vector<PendingModel> waiting = std::move(pending->second);
+    pendingLoads.erase(pending);
 
-    GLuint VAO, VBO, EBO, TBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-    glGenBuffers(1, &TBO);
+    // A synchronous loadModel may have registered the mesh in the meantime
+    uint32_t meshId = acquireMesh(data->path);
+    if (meshId == INVALID_MESH && parsed) {
+        meshId = uploadMesh(*data);
+    } else {
+        for (const SubmeshData& part : data->submeshes) {
+            if (part.textureRequest) textureCache.release(textureDecodePool.wait(part.textureRequest));
+        }
+    }
+    if (meshId == INVALID_MESH) {
+        // Loading failed, the placeholders never get geometry
+        for (const PendingModel& model : waiting) {
+            if (model.texture) textureCache.release(textureDecodePool.wait(model.texture));
+            sceneStore.remove(model.handle);
+        }
+        return;
+    }
 
-    glBindVertexArray(VAO);
+    // The acquired or registered reference covers the first model, take one more for each of the rest
+    bool firstReference = true;
+    for (const PendingModel& model : waiting) {
+        GLuint textureID = model.texture ? textureDecodePool.wait(model.texture) : 0;
+        if (!sceneStore.isValid(model.handle) || !hasUntexturedSubmesh(meshes[meshId])) {
+            // Removed while loading, or every submesh has its own texture
+            textureCache.release(textureID);
+            textureID = 0;
+        }
+        if (!sceneStore.isValid(model.handle)) continue;
+        if (!firstReference) meshes[meshId].refCount++;
+        firstReference = false;
 
-    // Vertex Buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
+        attachMesh(model.handle, meshId, textureID);
+    }
+    if (firstReference) {
+        releaseMesh(meshId); // Every waiting model was removed
+    }
+}
 
-    // Texture Coordinate Buffer
-    glBindBuffer(GL_ARRAY_BUFFER, TBO);
-    glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), texCoords.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (GLvoid*)0);
-    glEnableVertexAttribArray(1);
+// Add a model whose file is parsed on a worker thread. The handle is valid right
+// away and can be moved or rotated, the model is drawn once its mesh is uploaded.
+ModelHandle loadModelAsync(
+    const std::string& path, 
+    glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), 
+    glm::vec3 color = glm::vec3(0.0f, 0.0f, 0.0f), 
+    glm::vec3 scale = glm::vec3(1.0f), 
+    glm::vec3 rotationAxis = glm::vec3(0.0f, 0.0f, 0.0f),
+    const std::string& texturePath = ""
+)
+{
+    // Already loaded meshes need no worker
+    if (meshByPath.count(path)) {
+        return loadModel(path, position, color, scale, rotationAxis, texturePath);
+    }
 
-    // Element Buffer
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    color.x /= 255.0f;
+    color.y /= 255.0f;
+    color.z /= 255.0f;
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    ModelHandle handle = sceneStore.add(INVALID_MESH, position, color, scale, rotationAxis, 0);
 
-    if (!texturePath.empty() && textureID == 0) {
-        textureID = loadTexture(texturePath);
+    // Only the first request for a file starts a job, later ones wait on it
+    auto& waiting = pendingLoads[path];
+    std::shared_ptr<TextureRequest> texture;
+    if (!texturePath.empty()) {
+        texture = textureDecodePool.request(texturePath);
+    }
+    waiting.push_back({ handle, texture });
+    if (waiting.size() > 1) {
+        return handle;
     }
 
-    return { VAO, { static_cast<unsigned int>(indices.size()), position }, { color, scale, rotationAxis }, textureID };
-}
\ No newline at end of file
+    auto data = std::make_shared<MeshData>();
+    jobSystem.submit([data, path]() {
+        bool parsed = parseMesh(path, *data);
+        data->path = path;
+        jobSystem.runOnMainThread([data, parsed]() {
+            finishAsyncLoad(data, parsed);
+        });
+    });
+    return handle;
+}
+
+bool isModelReady(ModelHandle handle)
+{
+    int index = sceneStore.indexOf(handle);
+    return index >= 0 && sceneStore.meshIds[index] != INVALID_MESH;
+}
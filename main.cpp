@@ -3,7 +3,7 @@
 int main() {
     // Initialize GLFW
     if (!glfwInit()) {
-        std::cerr << "ERROR::GLFW Failed to initialize GLFW" << std::endl;
+        LOG_ERROR << "ERROR::GLFW Failed to initialize GLFW";
         return -1;
     }
 
@@ -15,7 +15,7 @@ int main() {
     // Create a windowed mode window and its OpenGL context
     window = glfwCreateWindow(800, 600, "Main App", NULL, NULL);
     if (!window) {
-        std::cerr << "ERROR::GLFW Failed to create GLFW window" << std::endl;
+        LOG_ERROR << "ERROR::GLFW Failed to create GLFW window";
         glfwTerminate();
         return -1;
     }
@@ -26,41 +26,50 @@ int main() {
     // Check OpenGL version
     const GLubyte* renderer = glGetString(GL_RENDERER);
     const GLubyte* version = glGetString(GL_VERSION);
-    std::cout << "INFO::GLFW Renderer: " << renderer << std::endl;
-    std::cout << "INFO::GLFW OpenGL version supported: " << version << std::endl;
+    LOG_INFO << "INFO::GLFW Renderer: " << renderer;
+    LOG_INFO << "INFO::GLFW OpenGL version supported: " << version;
 
     // Initialize GLEW
     glewExperimental = GL_TRUE; 
     if (glewInit() != GLEW_OK) {
-        std::cerr << "ERROR::GLEW Failed to initialize GLEW" << std::endl;
+        LOG_ERROR << "ERROR::GLEW Failed to initialize GLEW";
         return -1;
     }
 
-    glEnable(GL_DEPTH_TEST); // Enable depth testing
-
     // Set up camera
     Camera camera(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 0.0f);
     glfwSetWindowUserPointer(window, &camera);
     glfwSetCursorPosCallback(window, mouseCallback);
+    glfwSetMouseButtonCallback(window, mouseButtonCallback);
 
     // Set the framebuffer size callback
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
     // Compile shaders and create shader program
-    GLuint shaderProgram = compileShaders();
+    ShaderProgram shaderProgram = compileShaders();
+    createMatricesBuffer();
+    createInstanceBuffer();
+    createIndirectBuffer();
+    LOG_INFO << "INFO::RENDER Multi-draw indirect " << (multiDrawIndirectSupported() ? "available" : "unavailable, drawing batch by batch");
+    LOG_INFO << "INFO::TWEEN Easing kernel: " << easingKernel.name;
+
+    // Worker threads for loadModelAsync and for decoding textures
+    jobSystem.start();
+    textureDecodePool.start();
 
-    // Load models into a vector
-    //Example: models.push_back(loadModel("test.obj", glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(255.0f,0.0f,0.0f), glm::vec3(1.0f), glm::vec3(90.0f, 45.0f, 90.0f)));
+    // Load models into the scene
+    //Example: loadModelAsync("test.obj", glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(255.0f,0.0f,0.0f), glm::vec3(1.0f), glm::vec3(90.0f, 45.0f, 90.0f));
 
     // Set up projection matrix
     glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
 
-    glEnable(GL_DEPTH_TEST); // Enable depth testing
-    glEnable(GL_CULL_FACE);  // Enable backface culling
-    glCullFace(GL_BACK);      // Cull back faces
+    glState.enable(GL_DEPTH_TEST); // Enable depth testing
+    glState.enable(GL_CULL_FACE);  // Enable backface culling
+    glState.cullFace(GL_BACK);      // Cull back faces
 
     // Main loop
     float lastFrameTime = 0.0f;
+    float lastStatsTime = 0.0f;
     while (!glfwWindowShouldClose(window)) {
         // Process input
         float currentTime = glfwGetTime();
@@ -68,36 +77,55 @@ int main() {
         lastFrameTime = currentTime; // Update last frame time
         camera.processKeyboard(currentDeltaTime); // Adjust deltaTime as needed
 
+        // Upload models finished by the loader threads, capped so a big level cannot stall the frame
+        glState.beginFrame();
+        textureStreamer.beginFrame();
+        textureDecodePool.processDecodedImages(0.002);
+        textureStreamer.update(4 * 1024 * 1024); // Texture bytes per frame
+        jobSystem.processMainThreadTasks(0.004);
+
         // Clear the buffers
         glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Use the shader program
-        glUseProgram(shaderProgram);
-
         // Set the view and projection matrices
         glm::mat4 view = camera.getViewMatrix();
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        
         glm::mat4 projection = camera.getProjectionMatrix();
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        uploadFrameMatrices(view, projection);
+
+        // Use the shader program
+        glState.useProgram(shaderProgram.id);
 
         // Render all loaded models
-        renderModels(shaderProgram);
-        DoAllTweenRotate();
-        DoAllTweenMove();
+        renderModels(shaderProgram, extractFrustum(projection * view), camera.getPosition(), projection[1][1]);
+        tweenEngine.update(currentDeltaTime);
+
+        // Report the render stats once per second
+        if (currentTime - lastStatsTime >= 1.0f) {
+            std::string title = "Main App | visible: " + std::to_string(renderStats.visible) + " culled: " + std::to_string(renderStats.culled) + " draws: " + std::to_string(renderStats.drawCalls) + " tris: " + std::to_string(renderStats.triangles) + " moved: " + std::to_string(renderStats.transformsUpdated) + " state: " + std::to_string(renderStats.stateChanges) + " (skipped " + std::to_string(renderStats.stateChangesAvoided) + ") GL calls: " + std::to_string(glState.issuedLastFrame) + " (skipped " + std::to_string(glState.skippedLastFrame) + ")" + " upload KB: " + std::to_string(textureStreamer.bytesLastFrame / 1024) + " geometry MB: " + std::to_string(geometryBytesUsed() >> 20) + "/" + std::to_string(geometryBytesReserved() >> 20);
+            glfwSetWindowTitle(window, title.c_str());
+            lastStatsTime = currentTime;
+        }
 
         // Swap buffers
         glfwSwapBuffers(window);
+
+        // The next frame starts here, before input, so picks count toward its stats
+        renderStats = RenderStats();
         glfwPollEvents();
     }
 
     // Cleanup
-    for (const auto& model : models) {
-        GLuint VAO = std::get<0>(model); // Extract the VAO from the model tuple
-        glDeleteVertexArrays(1, &VAO);
-    }
-    glDeleteProgram(shaderProgram);
+    jobSystem.stop();
+    textureDecodePool.stop();
+    textureStreamer.destroy();
+    destroyAllMeshes();
+    destroyGeometryArenas();
+    textureCache.clear();
+    destroyInstanceBuffer();
+    destroyIndirectBuffer();
+    glState.deleteBuffer(matricesUBO);
+    glState.deleteProgram(shaderProgram.id);
     glfwDestroyWindow(window);
     glfwTerminate();
     return 0;
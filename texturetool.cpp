@@ -0,0 +1,395 @@
+// Offline texture converter: builds the full mip chain of an image and
+// optionally block-compresses it, writing <image>.rtex next to the source.
+// loadTexture picks the container up automatically. Build with `make texturetool`.
+//
+// Usage: texturetool [--format auto|rgba8|bc1|bc3] [--filter box|kaiser] image...
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <numbers>
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "MappedFile.h"
+#include "TextureContainer.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define TEXTURETOOL_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+// RGBA8 pixels of one mip level
+struct Level {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+// 2x2 box filter, odd edges repeat their last row or column
+Level downsampleBox(const Level& source) {
+    Level result;
+    result.width = std::max(1u, source.width / 2);
+    result.height = std::max(1u, source.height / 2);
+    result.pixels.resize(static_cast<size_t>(result.width) * result.height * 4);
+
+    for (uint32_t y = 0; y < result.height; y++) {
+        const unsigned char* row0 = &source.pixels[static_cast<size_t>(std::min(2 * y, source.height - 1)) * source.width * 4];
+        const unsigned char* row1 = &source.pixels[static_cast<size_t>(std::min(2 * y + 1, source.height - 1)) * source.width * 4];
+        unsigned char* out = &result.pixels[static_cast<size_t>(y) * result.width * 4];
+        uint32_t x = 0;
+
+#ifdef TEXTURETOOL_USE_SSE
+        // Two output pixels from four source pixels per row at a time
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi16(2);
+        for (; 2 * x + 3 < source.width; x += 2) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+            __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));   // Pixels 0 and 1
+            __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)); // Pixels 2 and 3
+            low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+            high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+            __m128i sum = _mm_unpacklo_epi64(low, high);
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(sum, zero));
+        }
+#endif
+        for (; x < result.width; x++) {
+            uint32_t x0 = std::min(2 * x, source.width - 1);
+            uint32_t x1 = std::min(2 * x + 1, source.width - 1);
+            for (int c = 0; c < 4; c++) {
+                int sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+                out[x * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+// Four float channels, one SSE register per pixel when available
+#ifdef TEXTURETOOL_USE_SSE
+typedef __m128 Pixel4;
+inline Pixel4 zeroPixel() { return _mm_setzero_ps(); }
+inline Pixel4 loadPixel(const float* source) { return _mm_loadu_ps(source); }
+inline void storePixel(float* destination, Pixel4 pixel) { _mm_storeu_ps(destination, pixel); }
+inline Pixel4 multiplyAdd(Pixel4 sum, Pixel4 pixel, float weight) { return _mm_add_ps(sum, _mm_mul_ps(pixel, _mm_set1_ps(weight))); }
+#else
+struct Pixel4 { float v[4]; };
+inline Pixel4 zeroPixel() { return Pixel4{ { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+inline Pixel4 loadPixel(const float* source) { Pixel4 p; std::memcpy(p.v, source, sizeof(p.v)); return p; }
+inline void storePixel(float* destination, Pixel4 pixel) { std::memcpy(destination, pixel.v, sizeof(pixel.v)); }
+inline Pixel4 multiplyAdd(Pixel4 sum, Pixel4 pixel, float weight) {
+    for (int c = 0; c < 4; c++) sum.v[c] += pixel.v[c] * weight;
+    return sum;
+}
+#endif
+
+// Zeroth order modified Bessel function of the first kind, for the Kaiser window
+double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 20; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Taps of a Kaiser-windowed sinc for halving, centered between two source pixels
+const int KAISER_TAPS = 8;
+
+std::vector<float> kaiserWeights(double alpha = 4.0) {
+    std::vector<float> weights(KAISER_TAPS);
+    double total = 0.0;
+    for (int i = 0; i < KAISER_TAPS; i++) {
+        double t = i - (KAISER_TAPS - 1) * 0.5;           // -3.5 .. 3.5 source pixels from the center
+        double x = t * 0.5;                               // In destination pixels
+        double sinc = std::abs(x) < 1e-6 ? 1.0 : std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+        double ratio = t / (KAISER_TAPS * 0.5);
+        double window = besselI0(alpha * std::sqrt(std::max(0.0, 1.0 - ratio * ratio))) / besselI0(alpha);
+        weights[i] = static_cast<float>(sinc * window);
+        total += weights[i];
+    }
+    for (float& weight : weights) weight = static_cast<float>(weight / total);
+    return weights;
+}
+
+// Separable Kaiser filter, sharper than the box filter without its aliasing.
+// Filters horizontally into a float buffer, then vertically into the result.
+Level downsampleKaiser(const Level& source, const std::vector<float>& weights) {
+    Level result;
+    result.width = std::max(1u, source.width / 2);
+    result.height = std::max(1u, source.height / 2);
+    result.pixels.resize(static_cast<size_t>(result.width) * result.height * 4);
+
+    // A side of length one is copied, there is nothing to halve
+    bool halveX = source.width > 1;
+    bool halveY = source.height > 1;
+    int first = -(KAISER_TAPS / 2 - 1);
+
+    std::vector<float> sourceFloats(source.pixels.begin(), source.pixels.end());
+    std::vector<float> horizontal(static_cast<size_t>(result.width) * source.height * 4);
+    for (uint32_t y = 0; y < source.height; y++) {
+        const float* row = &sourceFloats[static_cast<size_t>(y) * source.width * 4];
+        float* out = &horizontal[static_cast<size_t>(y) * result.width * 4];
+        for (uint32_t x = 0; x < result.width; x++) {
+            if (!halveX) {
+                storePixel(out + x * 4, loadPixel(row + x * 4));
+                continue;
+            }
+            Pixel4 sum = zeroPixel();
+            for (int i = 0; i < KAISER_TAPS; i++) {
+                int sx = std::clamp(static_cast<int>(2 * x) + first + i, 0, static_cast<int>(source.width) - 1);
+                sum = multiplyAdd(sum, loadPixel(row + sx * 4), weights[i]);
+            }
+            storePixel(out + x * 4, sum);
+        }
+    }
+
+    std::vector<float> column(4);
+    for (uint32_t y = 0; y < result.height; y++) {
+        unsigned char* out = &result.pixels[static_cast<size_t>(y) * result.width * 4];
+        for (uint32_t x = 0; x < result.width; x++) {
+            Pixel4 sum = zeroPixel();
+            if (!halveY) {
+                sum = loadPixel(&horizontal[(static_cast<size_t>(y) * result.width + x) * 4]);
+            } else {
+                for (int i = 0; i < KAISER_TAPS; i++) {
+                    int sy = std::clamp(static_cast<int>(2 * y) + first + i, 0, static_cast<int>(source.height) - 1);
+                    sum = multiplyAdd(sum, loadPixel(&horizontal[(static_cast<size_t>(sy) * result.width + x) * 4]), weights[i]);
+                }
+            }
+            storePixel(column.data(), sum);
+            for (int c = 0; c < 4; c++) {
+                out[x * 4 + c] = static_cast<unsigned char>(std::clamp(std::lround(column[c]), 0L, 255L));
+            }
+        }
+    }
+    return result;
+}
+
+uint16_t packColor565(const float* color) {
+    int r = std::clamp(static_cast<int>(std::lround(color[0] * 31.0f / 255.0f)), 0, 31);
+    int g = std::clamp(static_cast<int>(std::lround(color[1] * 63.0f / 255.0f)), 0, 63);
+    int b = std::clamp(static_cast<int>(std::lround(color[2] * 31.0f / 255.0f)), 0, 31);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpackColor565(uint16_t packed, int* color) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 color block: endpoints at the extremes of the principal axis of the block's colors
+void encodeColorBlock(const unsigned char block[16][4], unsigned char* out) {
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) mean[c] += block[i][c] / 16.0f;
+    }
+    float covariance[6] = {}; // rr rg rb gg gb bb
+    for (int i = 0; i < 16; i++) {
+        float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+        covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+        covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+    }
+
+    // Power iteration for the dominant eigenvector
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 4; iteration++) {
+        float next[3] = {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2],
+        };
+        float length = std::max({ std::abs(next[0]), std::abs(next[1]), std::abs(next[2]) });
+        if (length < 1e-6f) break;
+        for (int c = 0; c < 3; c++) axis[c] = next[c] / length;
+    }
+
+    int minIndex = 0, maxIndex = 0;
+    float minDot = 1e30f, maxDot = -1e30f;
+    for (int i = 0; i < 16; i++) {
+        float dot = block[i][0] * axis[0] + block[i][1] * axis[1] + block[i][2] * axis[2];
+        if (dot < minDot) { minDot = dot; minIndex = i; }
+        if (dot > maxDot) { maxDot = dot; maxIndex = i; }
+    }
+    float high[3], low[3];
+    for (int c = 0; c < 3; c++) {
+        high[c] = block[maxIndex][c];
+        low[c] = block[minIndex][c];
+    }
+    uint16_t color0 = packColor565(high);
+    uint16_t color1 = packColor565(low);
+    if (color0 < color1) std::swap(color0, color1); // color0 > color1 selects the four color mode
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        int palette[4][3];
+        unpackColor565(color0, palette[0]);
+        unpackColor565(color1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError) { bestError = error; best = p; }
+            }
+            indices |= static_cast<uint32_t>(best) << (2 * i);
+        }
+    }
+
+    out[0] = color0 & 0xFF; out[1] = color0 >> 8;
+    out[2] = color1 & 0xFF; out[3] = color1 >> 8;
+    for (int i = 0; i < 4; i++) out[4 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+// BC3 alpha block: min and max alpha with six interpolated steps
+void encodeAlphaBlock(const unsigned char block[16][4], unsigned char* out) {
+    int alpha0 = 0, alpha1 = 255;
+    for (int i = 0; i < 16; i++) {
+        alpha0 = std::max(alpha0, static_cast<int>(block[i][3]));
+        alpha1 = std::min(alpha1, static_cast<int>(block[i][3]));
+    }
+
+    uint64_t indices = 0;
+    if (alpha0 != alpha1) {
+        int palette[8] = { alpha0, alpha1 };
+        for (int p = 1; p < 7; p++) palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = 256;
+            for (int p = 0; p < 8; p++) {
+                int error = std::abs(block[i][3] - palette[p]);
+                if (error < bestError) { bestError = error; best = p; }
+            }
+            indices |= static_cast<uint64_t>(best) << (3 * i);
+        }
+    }
+
+    out[0] = static_cast<unsigned char>(alpha0);
+    out[1] = static_cast<unsigned char>(alpha1);
+    for (int i = 0; i < 6; i++) out[2 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+// Compress one level block by block, edge blocks repeat the last row or column
+std::vector<unsigned char> compressLevel(const Level& level, uint32_t format) {
+    std::vector<unsigned char> result(textureLevelSize(format, level.width, level.height));
+    unsigned char* out = result.data();
+    for (uint32_t by = 0; by < level.height; by += 4) {
+        for (uint32_t bx = 0; bx < level.width; bx += 4) {
+            unsigned char block[16][4];
+            for (uint32_t i = 0; i < 16; i++) {
+                uint32_t x = std::min(bx + i % 4, level.width - 1);
+                uint32_t y = std::min(by + i / 4, level.height - 1);
+                std::memcpy(block[i], &level.pixels[(static_cast<size_t>(y) * level.width + x) * 4], 4);
+            }
+            if (format == TEXTURE_FORMAT_BC3) {
+                encodeAlphaBlock(block, out);
+                out += 8;
+            }
+            encodeColorBlock(block, out);
+            out += 8;
+        }
+    }
+    return result;
+}
+
+bool convertImage(const std::string& path, const std::string& formatName, const std::string& filterName) {
+    uint64_t sourceHash;
+    if (!hashFile(path, sourceHash)) {
+        std::cerr << "ERROR::TEXTURETOOL Could not read: " << path << std::endl;
+        return false;
+    }
+
+    // Flipped the same way the renderer decodes images
+    stbi_set_flip_vertically_on_load(true);
+    Level base;
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!pixels) {
+        std::cerr << "ERROR::TEXTURETOOL Failed to decode: " << path << std::endl;
+        return false;
+    }
+    base.width = width;
+    base.height = height;
+    base.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+
+    uint32_t format = TEXTURE_FORMAT_RGBA8;
+    if (formatName == "bc1") {
+        format = TEXTURE_FORMAT_BC1;
+    } else if (formatName == "bc3") {
+        format = TEXTURE_FORMAT_BC3;
+    } else if (formatName == "auto") {
+        bool opaque = true;
+        for (size_t i = 3; i < base.pixels.size() && opaque; i += 4) opaque = base.pixels[i] == 255;
+        format = opaque ? TEXTURE_FORMAT_BC1 : TEXTURE_FORMAT_BC3;
+    }
+
+    std::vector<float> weights = kaiserWeights();
+    std::vector<Level> chain;
+    chain.push_back(std::move(base));
+    while (chain.back().width > 1 || chain.back().height > 1) {
+        chain.push_back(filterName == "box" ? downsampleBox(chain.back()) : downsampleKaiser(chain.back(), weights));
+    }
+
+    std::vector<std::vector<unsigned char>> levelData;
+    std::vector<TextureContainerLevel> levels;
+    size_t totalSize = 0;
+    for (Level& level : chain) {
+        levels.push_back({ level.width, level.height, 0, 0 });
+        levelData.push_back(format == TEXTURE_FORMAT_RGBA8 ? std::move(level.pixels) : compressLevel(level, format));
+        totalSize += levelData.back().size();
+    }
+
+    TextureContainerHeader header = {};
+    header.sourceHash = sourceHash;
+    header.width = width;
+    header.height = height;
+    header.format = format;
+    if (!writeTextureContainer(textureContainerPath(path), header, levelData, levels)) {
+        std::cerr << "ERROR::TEXTURETOOL Failed to write: " << textureContainerPath(path) << std::endl;
+        return false;
+    }
+
+    const char* formatNames[] = { "rgba8", "bc1", "bc3" };
+    std::cout << "INFO::TEXTURETOOL " << path << ": " << width << "x" << height << ", " << chain.size() << " mips, "
+              << formatNames[format] << ", " << totalSize / 1024 << " KB" << std::endl;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string formatName = "auto";
+    std::string filterName = "kaiser";
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--format" && i + 1 < argc) {
+            formatName = argv[++i];
+        } else if (argument == "--filter" && i + 1 < argc) {
+            filterName = argv[++i];
+        } else {
+            paths.push_back(argument);
+        }
+    }
+
+    bool validFormat = formatName == "auto" || formatName == "rgba8" || formatName == "bc1" || formatName == "bc3";
+    bool validFilter = filterName == "box" || filterName == "kaiser";
+    if (paths.empty() || !validFormat || !validFilter) {
+        std::cerr << "Usage: texturetool [--format auto|rgba8|bc1|bc3] [--filter box|kaiser] image..." << std::endl;
+        return 1;
+    }
+
+    int failures = 0;
+    for (const std::string& path : paths) {
+        if (!convertImage(path, formatName, filterName)) failures++;
+    }
+    return failures == 0 ? 0 : 1;
+}
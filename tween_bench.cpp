@@ -0,0 +1,92 @@
+// Standalone benchmark for the tween engine: per-frame update time against
+// the number of concurrent tweens, with position and rotation tweens spread
+// over every easing curve. No window or GL context is created, the models
+// have no mesh so only the tween passes and the scene writes are timed.
+// Build with `make tween-bench`.
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <algorithm>
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "TweenEngine.h"
+
+using Clock = std::chrono::high_resolution_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t maxTweens = argc > 1 ? std::stoul(argv[1]) : 200000;
+    const int frames = 120;
+    const float frameTime = 1.0f / 60.0f;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> angle(-3.0f, 3.0f);
+    // Long enough that most tweens are still running at the end of the run
+    std::uniform_real_distribution<float> seconds(1.5f, 4.0f);
+
+    std::vector<EaseType> curves;
+    for (int type = EASE_LINEAR; type <= EASE_BOUNCE_IN_OUT; type++) curves.push_back(static_cast<EaseType>(type));
+    curves.push_back(registerCubicBezier(0.25f, 0.1f, 0.25f, 1.0f));
+    curves.push_back(registerCubicBezier(0.68f, -0.6f, 0.32f, 1.6f));
+
+    std::cout << "easing kernel: " << easingKernel.name << std::endl;
+    std::cout << std::left << std::setw(10) << "tweens"
+              << std::setw(14) << "start ms"
+              << std::setw(14) << "avg ms"
+              << std::setw(14) << "max ms"
+              << std::setw(14) << "ns/tween"
+              << std::setw(14) << "left" << std::endl;
+
+    for (size_t count = 1000; count <= maxTweens; count *= 10) {
+        sceneStore = SceneStore();
+        tweenEngine.clear();
+
+        // Half the models move, the other half rotate
+        std::vector<ModelHandle> handles(count);
+        for (size_t i = 0; i < count; i++) {
+            handles[i] = sceneStore.add(INVALID_MESH, glm::vec3(position(rng), position(rng), position(rng)), glm::vec3(1.0f), glm::vec3(1.0f), glm::vec3(0.0f, angle(rng), 0.0f), 0);
+        }
+
+        auto start = Clock::now();
+        for (size_t i = 0; i < count; i++) {
+            EaseType ease = curves[i % curves.size()];
+            if (i % 2 == 0) {
+                glm::vec3 target(position(rng), position(rng), position(rng));
+                tweenEngine.startPosition(handles[i], sceneStore.position(handles[i]), target, seconds(rng), ease);
+            } else {
+                glm::quat target = axisAngleRotation(glm::vec3(angle(rng), angle(rng), angle(rng)));
+                tweenEngine.startRotation(handles[i], sceneStore.rotation(handles[i]), target, seconds(rng), ease);
+            }
+        }
+        double startTime = millisecondsSince(start);
+
+        double total = 0.0, worst = 0.0;
+        for (int frame = 0; frame < frames; frame++) {
+            // The renderer clears the dirty list once a frame, outside the timing
+            for (ModelHandle handle : sceneStore.dirtyModels) sceneStore.transformDirty[sceneStore.indexOf(handle)] = 0;
+            sceneStore.dirtyModels.clear();
+
+            start = Clock::now();
+            tweenEngine.update(frameTime);
+            double updateTime = millisecondsSince(start);
+            total += updateTime;
+            worst = std::max(worst, updateTime);
+        }
+
+        double average = total / frames;
+        std::cout << std::left << std::setw(10) << count
+                  << std::setw(14) << startTime
+                  << std::setw(14) << average
+                  << std::setw(14) << worst
+                  << std::setw(14) << average * 1e6 / count
+                  << std::setw(14) << tweenEngine.size() << std::endl;
+    }
+    return 0;
+}